@@ -53,6 +53,38 @@ const Expr* Expr::skip_rvalue() const {
 
 uint64_t LiteralExpr::get_u64() const { return thorin::bcast<uint64_t, thorin::Box>(box()); }
 
+int64_t LiteralPtrn::get_s64() const {
+    auto value = literal()->get_u64();
+    if (has_minus())
+        value = -value;
+
+    switch (literal()->tag()) {
+        case LiteralExpr::LIT_i8:  return   int8_t(value);
+        case LiteralExpr::LIT_i16: return  int16_t(value);
+        case LiteralExpr::LIT_i32: return  int32_t(value);
+        case LiteralExpr::LIT_u8:  return  uint8_t(value);
+        case LiteralExpr::LIT_u16: return uint16_t(value);
+        case LiteralExpr::LIT_u32: return uint32_t(value);
+        default:                   return  int64_t(value);
+    }
+}
+
+bool FnDecl::is_primop() const {
+    switch (intrinsic()) {
+#define IMPALA_INTRINSIC(name, primop) case Intrinsic_##name: return primop;
+#include "impala/intrinsiclist.h"
+        default: return false;
+    }
+}
+
+const Attr* AttrList::attr(Symbol symbol) const {
+    for (const auto& attr : attrs()) {
+        if (attr->symbol() == symbol)
+            return attr.get();
+    }
+    return nullptr;
+}
+
 bool IfExpr::has_else() const {
     if (auto block = else_expr_->isa<BlockExpr>())
         return !block->empty();
@@ -157,6 +189,15 @@ bool LiteralPtrn::is_refutable() const {
     return true;
 }
 
+bool RangePtrn::is_refutable() const {
+    return true;
+}
+
+bool OrPtrn::is_refutable() const {
+    return std::all_of(alts_.begin(), alts_.end(),
+        [] (const std::unique_ptr<const Ptrn>& p) { return p->is_refutable(); });
+}
+
 //------------------------------------------------------------------------------
 
 const PrefixExpr* replace_rvalue_by_addrof(const RValueExpr* rvalue) {
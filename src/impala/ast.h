@@ -25,6 +25,7 @@ namespace impala {
 
 class ASTType;
 class ASTTypeApp;
+class Attr;
 class ASTTypeParam;
 class Decl;
 class Expr;
@@ -53,6 +54,7 @@ typedef std::vector<std::string> Strings;
 typedef std::vector<std::unique_ptr<const ASTType>> ASTTypes;
 typedef std::vector<std::unique_ptr<const ASTTypeApp>> ASTTypeApps;
 typedef std::vector<std::unique_ptr<const ASTTypeParam>> ASTTypeParams;
+typedef std::vector<std::unique_ptr<const Attr>> Attrs;
 typedef std::vector<std::unique_ptr<const FieldDecl>> FieldDecls;
 typedef std::vector<std::unique_ptr<const OptionDecl>> OptionDecls;
 typedef std::vector<std::unique_ptr<const FnDecl>> FnDecls;
@@ -172,6 +174,52 @@ private:
     Symbol symbol_;
 };
 
+/// An attribute like <tt>#[unroll(4)]</tt> or <tt>#[target_cpu("znver2")]</tt>: a name with optional integer or string arguments.
+class Attr : public ASTNode {
+public:
+    Attr(Location location, Symbol symbol, std::vector<uint64_t>&& args, Strings&& strs)
+        : ASTNode(location)
+        , symbol_(symbol)
+        , args_(std::move(args))
+        , strs_(std::move(strs))
+    {}
+
+    Symbol symbol() const { return symbol_; }
+    /// Integer arguments.
+    ArrayRef<uint64_t> args() const { return args_; }
+    uint64_t arg(size_t i) const { return args_[i]; }
+    size_t num_args() const { return args_.size(); }
+    /// String arguments without quotes.
+    const Strings& strs() const { return strs_; }
+    const std::string& str(size_t i) const { return strs_[i]; }
+    size_t num_strs() const { return strs_.size(); }
+    std::ostream& stream(std::ostream&) const override;
+
+private:
+    Symbol symbol_;
+    std::vector<uint64_t> args_;
+    Strings strs_;
+};
+
+/// Base for @p ASTNode%s which may be annotated with @p Attr%s.
+class AttrList {
+public:
+    AttrList(Attrs&& attrs)
+        : attrs_(std::move(attrs))
+    {}
+
+    const Attrs& attrs() const { return attrs_; }
+    /// Returns the attribute named @p symbol or @c nullptr.
+    const Attr* attr(Symbol symbol) const;
+    std::ostream& stream_attrs(std::ostream&) const;
+
+protected:
+    /// Reports unknown, repeated and malformed attributes; @p num_args maps each allowed name to its maximal number of arguments.
+    void check_attrs(const char* what, std::initializer_list<std::pair<const char*, size_t>> num_args) const;
+
+    Attrs attrs_;
+};
+
 class Typeable : public ASTNode {
 public:
     Typeable(Location location) : ASTNode(location) {}
@@ -304,14 +352,35 @@ private:
     Tag tag_;
 };
 
+/// Integer literal as argument of a const type parameter or as dimension of an array or simd type.
+class ConstASTType : public ASTType {
+public:
+    ConstASTType(Location location, uint64_t value)
+        : ASTType(location)
+        , value_(value)
+    {}
+
+    uint64_t value() const { return value_; }
+
+    void bind(NameSema&) const override;
+    std::ostream& stream(std::ostream&) const override;
+
+private:
+    const Type* infer(InferSema&) const override;
+    void check(TypeSema&) const override;
+
+    uint64_t value_;
+};
+
 class PtrASTType : public ASTType {
 public:
     enum Tag { Borrowed, Mut, Owned };
 
-    PtrASTType(Location location, Tag tag, int addr_space, const ASTType* referenced_ast_type)
+    PtrASTType(Location location, Tag tag, int addr_space, int align, const ASTType* referenced_ast_type)
         : ASTType(location)
         , tag_(tag)
         , addr_space_(addr_space)
+        , align_(align)
         , referenced_ast_type_(referenced_ast_type)
     {}
 
@@ -319,6 +388,8 @@ public:
     std::string prefix() const;
     const ASTType* referenced_ast_type() const { return referenced_ast_type_.get(); }
     int addr_space() const { return addr_space_; }
+    /// Guaranteed alignment of the pointee in bytes or 0 if nothing is known.
+    int align() const { return align_; }
 
     void bind(NameSema&) const override;
     std::ostream& stream(std::ostream&) const override;
@@ -329,6 +400,7 @@ private:
 
     Tag tag_;
     int addr_space_;
+    int align_;
     std::unique_ptr<const ASTType> referenced_ast_type_;
 };
 
@@ -361,12 +433,13 @@ private:
 
 class DefiniteArrayASTType : public ArrayASTType {
 public:
-    DefiniteArrayASTType(Location location, const ASTType* elem_ast_type, uint64_t dim)
+    DefiniteArrayASTType(Location location, const ASTType* elem_ast_type, const ASTType* dim)
         : ArrayASTType(location, elem_ast_type)
         , dim_(dim)
     {}
 
-    uint64_t dim() const { return dim_; }
+    /// A @p ConstASTType or an @p ASTTypeApp naming a const type parameter.
+    const ASTType* dim() const { return dim_.get(); }
 
     void bind(NameSema&) const override;
     std::ostream& stream(std::ostream&) const override;
@@ -375,7 +448,7 @@ private:
     const Type* infer(InferSema&) const override;
     void check(TypeSema&) const override;
 
-    uint64_t dim_;
+    std::unique_ptr<const ASTType> dim_;
 };
 
 class CompoundASTType : public ASTType {
@@ -477,12 +550,35 @@ private:
 
 class SimdASTType : public ArrayASTType {
 public:
-    SimdASTType(Location location, const ASTType* elem_ast_type, uint64_t size)
+    SimdASTType(Location location, const ASTType* elem_ast_type, const ASTType* size)
         : ArrayASTType(location, elem_ast_type)
         , size_(size)
     {}
 
-    uint64_t size() const { return size_; }
+    /// A @p ConstASTType or an @p ASTTypeApp naming a const type parameter.
+    const ASTType* size() const { return size_.get(); }
+
+    void bind(NameSema&) const override;
+    std::ostream& stream(std::ostream&) const override;
+
+private:
+    const Type* infer(InferSema&) const override;
+    void check(TypeSema&) const override;
+
+    std::unique_ptr<const ASTType> size_;
+};
+
+/// <tt>slice[T]</tt>, <tt>slice[mut T]</tt> or <tt>slice[mut [addr_space] T]</tt> - pointer to @c T elements together with their number.
+class SliceASTType : public ArrayASTType {
+public:
+    SliceASTType(Location location, bool mut, int addr_space, const ASTType* elem_ast_type)
+        : ArrayASTType(location, elem_ast_type)
+        , mut_(mut)
+        , addr_space_(addr_space)
+    {}
+
+    bool is_mut() const { return mut_; }
+    int addr_space() const { return addr_space_; }
 
     void bind(NameSema&) const override;
     std::ostream& stream(std::ostream&) const override;
@@ -491,7 +587,8 @@ private:
     const Type* infer(InferSema&) const override;
     void check(TypeSema&) const override;
 
-    uint64_t size_;
+    bool mut_;
+    int addr_space_;
 };
 
 //------------------------------------------------------------------------------
@@ -619,13 +716,16 @@ protected:
 
 class ASTTypeParam : public Decl {
 public:
-    ASTTypeParam(Location location, const Identifier* id, ASTTypes&& bounds)
+    ASTTypeParam(Location location, const Identifier* id, ASTTypes&& bounds, bool is_const = false)
         : Decl(TypeDecl, location, id)
         , bounds_(std::move(bounds))
+        , is_const_(is_const)
     {}
 
     size_t num_bounds() const { return bounds().size(); }
     const ASTTypes& bounds() const { return bounds_; }
+    /// <tt>N: const</tt> - the argument is an integer which may be used as dimension of array and simd types.
+    bool is_const() const { return is_const_; }
     int lambda_depth() const { return lambda_depth_; }
     const Var* var() const { return type()->as<Var>(); }
 
@@ -637,6 +737,7 @@ private:
     const Var* infer(InferSema&) const;
 
     ASTTypes bounds_;
+    bool is_const_;
     mutable int lambda_depth_ = -1;
 
     friend class ASTTypeApp;
@@ -646,9 +747,10 @@ private:
 
 class Param : public LocalDecl {
 public:
-    Param(Location location, size_t handle, bool mut, const Identifier* id, const ASTType* ast_type, const Expr* pe_expr = nullptr)
+    Param(Location location, size_t handle, bool mut, const Identifier* id, const ASTType* ast_type, const Expr* pe_expr = nullptr, bool noalias = false)
         : LocalDecl(location, handle, mut, id, ast_type)
         , pe_expr_(dock(pe_expr_, pe_expr))
+        , noalias_(noalias)
     {}
 
     Param(Location location, size_t handle, const Identifier* id, const ASTType* ast_type, const Expr* pe_expr = nullptr)
@@ -656,16 +758,26 @@ public:
     {}
 
     const Expr* pe_expr() const { return pe_expr_.get(); }
+    /// The memory behind this pointer parameter is not accessed through any other argument of the call.
+    bool is_noalias() const { return noalias_; }
     std::ostream& stream(std::ostream&) const override;
 
 private:
     std::unique_ptr<const Expr> pe_expr_;
+    bool noalias_;
 };
 
-class Fn : public ASTTypeParamList {
+/**
+ * Common base of @p FnDecl and @p FnExpr.
+ * Takes the attributes <tt>#[always_inline]</tt>, <tt>#[noinline]</tt>, <tt>#[hot]</tt>, <tt>#[cold]</tt>,
+ * <tt>#[target_cpu("...")]</tt> and <tt>#[target_features("...")]</tt>.
+ * All but @c always_inline become attributes of the LLVM function; they need a first-order function item.
+ */
+class Fn : public ASTTypeParamList, public AttrList {
 public:
-    Fn(const Expr* pe_expr, ASTTypeParams&& ast_type_params, Params&& params, const Expr* body)
+    Fn(const Expr* pe_expr, ASTTypeParams&& ast_type_params, Params&& params, const Expr* body, Attrs&& attrs = Attrs())
         : ASTTypeParamList(std::move(ast_type_params))
+        , AttrList(std::move(attrs))
         , pe_expr_(dock(pe_expr_, pe_expr))
         , params_(std::move(params))
         , body_(dock(body_, body))
@@ -682,8 +794,10 @@ public:
     std::ostream& stream_params(std::ostream& p, bool returning) const;
     void fn_bind(NameSema&) const;
     const Type* check_body(TypeSema&) const;
+    void check_fn_attrs() const;
     thorin::Continuation* emit_head(CodeGen&, Location) const;
     void emit_body(CodeGen&, Location loc) const;
+    void emit_instance(CodeGen&, thorin::Continuation*, Location loc) const;
 
     virtual const FnType* fn_type() const = 0;
     virtual Symbol fn_symbol() const = 0;
@@ -847,10 +961,11 @@ private:
     std::unique_ptr<const ASTType> ast_type_;
 };
 
-class FieldDecl : public Decl {
+class FieldDecl : public Decl, public AttrList {
 public:
-    FieldDecl(Location location, size_t index, Visibility vis, const Identifier* id, const ASTType* ast_type)
+    FieldDecl(Location location, size_t index, Visibility vis, const Identifier* id, const ASTType* ast_type, Attrs&& attrs = Attrs())
         : Decl(TypeableDecl, location, id)
+        , AttrList(std::move(attrs))
         , index_(index)
         , visibility_(vis)
         , ast_type_(std::move(ast_type))
@@ -875,11 +990,12 @@ private:
     friend class TypeSema;
 };
 
-class StructDecl : public TypeDeclItem {
+class StructDecl : public TypeDeclItem, public AttrList {
 public:
     StructDecl(Location location, Visibility vis, const Identifier* id,
-               ASTTypeParams&& ast_type_params, FieldDecls&& field_decls)
+               ASTTypeParams&& ast_type_params, FieldDecls&& field_decls, Attrs&& attrs = Attrs())
         : TypeDeclItem(location, vis, id, std::move(ast_type_params))
+        , AttrList(std::move(attrs))
         , field_decls_(std::move(field_decls))
     {}
 
@@ -994,12 +1110,19 @@ private:
     std::unique_ptr<const Expr> init_;
 };
 
+/// Functions of an <tt>extern "thorin"</tt> block known to the front end - resolved once by @p NameSema.
+enum Intrinsic {
+    Intrinsic_None,
+#define IMPALA_INTRINSIC(name, primop) Intrinsic_##name,
+#include "impala/intrinsiclist.h"
+};
+
 class FnDecl : public ValueItem, public Fn {
 public:
     FnDecl(Location location, Visibility vis, bool is_extern, Symbol abi, const Expr* pe_expr, Symbol export_name,
-           const Identifier* id, ASTTypeParams&& ast_type_params, Params&& params, const Expr* body)
+           const Identifier* id, ASTTypeParams&& ast_type_params, Params&& params, const Expr* body, Attrs&& attrs = Attrs())
         : ValueItem(location, vis, /*mut*/ false, id, /*ast_type*/ nullptr)
-        , Fn(pe_expr, std::move(ast_type_params), std::move(params), body)
+        , Fn(pe_expr, std::move(ast_type_params), std::move(params), body, std::move(attrs))
         , abi_(abi)
         , export_name_(export_name)
         , is_extern_(is_extern)
@@ -1007,6 +1130,9 @@ public:
 
     bool is_extern() const { return is_extern_; }
     Symbol abi() const { return abi_; }
+    Intrinsic intrinsic() const { return intrinsic_; }
+    /// Calls map directly to a thorin primop - no function is emitted for this declaration.
+    bool is_primop() const;
 
     const FnType* fn_type() const override {
         auto t = type();
@@ -1027,6 +1153,7 @@ private:
     Symbol abi_;
     Symbol export_name_;
     bool is_extern_ = false;
+    mutable Intrinsic intrinsic_ = Intrinsic_None;
 };
 
 class TraitDecl : public Item, public ASTTypeParamList {
@@ -1281,9 +1408,9 @@ private:
 
 class FnExpr : public Expr, public Fn {
 public:
-    FnExpr(Location location, const Expr* pe_expr, Params&& params, const Expr* body)
+    FnExpr(Location location, const Expr* pe_expr, Params&& params, const Expr* body, Attrs&& attrs = Attrs())
         : Expr(location)
-        , Fn(pe_expr, ASTTypeParams(), std::move(params), body)
+        , Fn(pe_expr, ASTTypeParams(), std::move(params), body, std::move(attrs))
     {}
 
     const FnType* fn_type() const override { return type()->as<FnType>(); }
@@ -1559,14 +1686,20 @@ private:
 
 class RepeatedDefiniteArrayExpr : public Expr {
 public:
-    RepeatedDefiniteArrayExpr(Location location, const Expr* value, uint64_t count)
+    RepeatedDefiniteArrayExpr(Location location, const Expr* value, const ASTType* count)
         : Expr(location)
         , value_(dock(value_, value))
         , count_(count)
     {}
 
     const Expr* value() const { return value_.get(); }
-    uint64_t count() const { return count_; }
+    /// A @p ConstASTType or an @p ASTTypeApp naming a const type parameter.
+    const ASTType* count() const { return count_.get(); }
+    /**
+     * Large arrays aren't expanded to one def per element: statics become a global of O(log count) defs,
+     * all other arrays a stack slot filled by a loop - locals use the slot directly, other uses load the array from it.
+     */
+    static bool is_compact(uint64_t count) { return count > 64; }
 
     void bind(NameSema&) const override;
     std::ostream& stream(std::ostream&) const override;
@@ -1577,7 +1710,7 @@ private:
     const thorin::Def* remit(CodeGen&) const override;
 
     std::unique_ptr<const Expr> value_;
-    uint64_t count_;
+    std::unique_ptr<const ASTType> count_;
 };
 
 class IndefiniteArrayExpr : public Expr {
@@ -1635,6 +1768,37 @@ private:
     const thorin::Def* remit(CodeGen&) const override;
 };
 
+/**
+ * Contents of a file read at compile time as definite array of @p elem_ast_type (@c u8 if absent).
+ * The file is read by the parser; elements wider than a byte are taken in host byte order.
+ * The contents become a single packed constant in the LLVM module.
+ */
+class IncludeBytesExpr : public Expr {
+public:
+    IncludeBytesExpr(Location location, const ASTType* elem_ast_type, std::string&& path, std::string&& bytes)
+        : Expr(location)
+        , elem_ast_type_(elem_ast_type)
+        , path_(std::move(path))
+        , bytes_(std::move(bytes))
+    {}
+
+    const ASTType* elem_ast_type() const { return elem_ast_type_.get(); }
+    const std::string& path() const { return path_; }
+    const std::string& bytes() const { return bytes_; }
+
+    void bind(NameSema&) const override;
+    std::ostream& stream(std::ostream&) const override;
+
+private:
+    const Type* infer(InferSema&) const override;
+    void check(TypeSema&) const override;
+    const thorin::Def* remit(CodeGen&) const override;
+
+    std::unique_ptr<const ASTType> elem_ast_type_;
+    std::string path_;
+    std::string bytes_;
+};
+
 class StructExpr : public Expr {
 public:
     class Elem : public ASTNode {
@@ -1748,10 +1912,43 @@ private:
     friend class CodeGen;
 };
 
-class BlockExpr : public Expr {
+/**
+ * <tt>lhs(begin..end)</tt> - the elements @p begin up to but excluding @p end as slice without copying them.
+ * @p lhs is a slice or a pointer to an array; the slice is mutable if @p lhs is and lives in its address space.
+ * Unless bounds checks are disabled, the range is checked against the length of @p lhs at run time.
+ * The length of an indefinite array is unknown, so only <tt>begin <= end</tt> is checked for those.
+ */
+class SliceExpr : public Expr {
+public:
+    SliceExpr(Location location, const Expr* lhs, const Expr* begin, const Expr* end)
+        : Expr(location)
+        , lhs_(dock(lhs_, lhs))
+        , begin_(dock(begin_, begin))
+        , end_(dock(end_, end))
+    {}
+
+    const Expr* lhs() const { return lhs_.get(); }
+    const Expr* begin() const { return begin_.get(); }
+    const Expr* end() const { return end_.get(); }
+
+    void bind(NameSema&) const override;
+    std::ostream& stream(std::ostream&) const override;
+
+private:
+    const Type* infer(InferSema&) const override;
+    void check(TypeSema&) const override;
+    const thorin::Def* remit(CodeGen&) const override;
+
+    std::unique_ptr<const Expr> lhs_;
+    std::unique_ptr<const Expr> begin_;
+    std::unique_ptr<const Expr> end_;
+};
+
+class BlockExpr : public Expr, public AttrList {
 public:
-    BlockExpr(Location location, Stmts&& stmts, const Expr* expr)
+    BlockExpr(Location location, Stmts&& stmts, const Expr* expr, Attrs&& attrs = Attrs())
         : Expr(location)
+        , AttrList(std::move(attrs))
         , stmts_(std::move(stmts))
         , expr_(dock(expr_, expr))
     {}
@@ -1856,11 +2053,16 @@ private:
     Arms arms_;
 };
 
-class WhileExpr : public Expr {
+/**
+ * A while loop - may carry the loop hints <tt>#[unroll(N)]</tt>, <tt>#[no_unroll]</tt>, <tt>#[vectorize(N)]</tt> and <tt>#[parallel]</tt>.
+ * They become @c llvm.loop metadata of the loop; @c parallel also puts its memory accesses into one access group.
+ */
+class WhileExpr : public Expr, public AttrList {
 public:
     WhileExpr(Location location, const LocalDecl* continue_decl, const Expr* cond,
-              const Expr* body, const LocalDecl* break_decl)
+              const Expr* body, const LocalDecl* break_decl, Attrs&& attrs = Attrs())
         : Expr(location)
+        , AttrList(std::move(attrs))
         , continue_decl_(continue_decl)
         , cond_(dock(cond_, cond))
         , body_(dock(body_, body))
@@ -1888,10 +2090,12 @@ private:
     std::unique_ptr<const LocalDecl> break_decl_;
 };
 
-class ForExpr : public Expr {
+/// A for loop - takes the same loop hints as @p WhileExpr; a plain <tt>#[unroll]</tt> unrolls it completely.
+class ForExpr : public Expr, public AttrList {
 public:
-    ForExpr(Location location, const Expr* fn_expr, const Expr* expr, const LocalDecl* break_decl)
+    ForExpr(Location location, const Expr* fn_expr, const Expr* expr, const LocalDecl* break_decl, Attrs&& attrs = Attrs())
         : Expr(location)
+        , AttrList(std::move(attrs))
         , fn_expr_(dock(fn_expr_, fn_expr))
         , expr_(dock(expr_, expr))
         , break_decl_(break_decl)
@@ -2023,6 +2227,8 @@ public:
 
     const LiteralExpr* literal() const { return literal_.get()->as<LiteralExpr>(); }
     bool has_minus() const { return minus_; }
+    /// Value of an integer pattern including its sign - sign-extended for signed literals.
+    int64_t get_s64() const;
 
     void bind(NameSema&) const override;
     void emit(CodeGen&, const thorin::Def*) const override;
@@ -2039,6 +2245,57 @@ private:
     bool minus_;
 };
 
+/// Inclusive integer range <tt>lo..hi</tt>.
+class RangePtrn : public Ptrn {
+public:
+    RangePtrn(Location location, const LiteralPtrn* lo, const LiteralPtrn* hi)
+        : Ptrn(location)
+        , lo_(lo)
+        , hi_(hi)
+    {}
+
+    const LiteralPtrn* lo() const { return lo_.get(); }
+    const LiteralPtrn* hi() const { return hi_.get(); }
+
+    void bind(NameSema&) const override;
+    void emit(CodeGen&, const thorin::Def*) const override;
+    const thorin::Def* emit_cond(CodeGen&, const thorin::Def*) const override;
+    bool is_refutable() const override;
+    std::ostream& stream(std::ostream&) const override;
+
+private:
+    const Type* infer(InferSema&) const override;
+    void check(TypeSema&) const override;
+
+    std::unique_ptr<const LiteralPtrn> lo_;
+    std::unique_ptr<const LiteralPtrn> hi_;
+};
+
+/// Matches if any of its alternatives <tt>p1 | p2 | ...</tt> matches; alternatives must not bind variables.
+class OrPtrn : public Ptrn {
+public:
+    OrPtrn(Location location, Ptrns&& alts)
+        : Ptrn(location)
+        , alts_(std::move(alts))
+    {}
+
+    const Ptrns& alts() const { return alts_; }
+    const Ptrn* alt(size_t i) const { return alts_[i].get(); }
+    size_t num_alts() const { return alts_.size(); }
+
+    void bind(NameSema&) const override;
+    void emit(CodeGen&, const thorin::Def*) const override;
+    const thorin::Def* emit_cond(CodeGen&, const thorin::Def*) const override;
+    bool is_refutable() const override;
+    std::ostream& stream(std::ostream&) const override;
+
+private:
+    const Type* infer(InferSema&) const override;
+    void check(TypeSema&) const override;
+
+    Ptrns alts_;
+};
+
 //------------------------------------------------------------------------------
 
 /*
@@ -0,0 +1,224 @@
+#include "impala/cache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+#ifdef __linux__
+#include <link.h>
+#endif
+
+namespace impala {
+
+//------------------------------------------------------------------------------
+
+/*
+ * Hasher
+ */
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+Hasher::Hasher()
+    : state_{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19}
+{}
+
+void Hasher::compress(const unsigned char* block) {
+    uint32_t w[64];
+    for (int i = 0; i != 16; ++i)
+        w[i] = uint32_t(block[4*i]) << 24 | uint32_t(block[4*i+1]) << 16 | uint32_t(block[4*i+2]) << 8 | uint32_t(block[4*i+3]);
+    for (int i = 16; i != 64; ++i) {
+        uint32_t s0 = rotr(w[i-15], 7) ^ rotr(w[i-15], 18) ^ (w[i-15] >> 3);
+        uint32_t s1 = rotr(w[i-2], 17) ^ rotr(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+    uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+    uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+    for (int i = 0; i != 64; ++i) {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state_[0] += a; state_[1] += b; state_[2] += c; state_[3] += d;
+    state_[4] += e; state_[5] += f; state_[6] += g; state_[7] += h;
+}
+
+void Hasher::add(const std::string& s) {
+    for (unsigned char c : s) {
+        block_[size_++ % 64] = c;
+        if (size_ % 64 == 0)
+            compress(block_);
+    }
+}
+
+std::string Hasher::hash() const {
+    // pad a copy so that more data can be added afterwards
+    Hasher final = *this;
+    std::string padding(1, '\x80');
+    padding.append((119 - size_ % 64) % 64, '\0');
+    for (int i = 7; i >= 0; --i)
+        padding += char((size_ * 8) >> (8 * i));
+    final.add(padding);
+
+    std::ostringstream oss;
+    oss << std::hex << std::setfill('0');
+    for (auto word : final.state_)
+        oss << std::setw(8) << word;
+    return oss.str();
+}
+
+//------------------------------------------------------------------------------
+
+/*
+ * build ID
+ */
+
+#ifdef __linux__
+static int add_object(struct dl_phdr_info* info, size_t, void* data) {
+    auto& hasher = *static_cast<Hasher*>(data);
+    for (int i = 0; i != info->dlpi_phnum; ++i) {
+        const auto& phdr = info->dlpi_phdr[i];
+        if (phdr.p_type != PT_NOTE)
+            continue;
+        auto note = reinterpret_cast<const char*>(info->dlpi_addr + phdr.p_vaddr);
+        auto end = note + phdr.p_memsz;
+        while (note + sizeof(ElfW(Nhdr)) <= end) {
+            auto nhdr = reinterpret_cast<const ElfW(Nhdr)*>(note);
+            auto name = note + sizeof(ElfW(Nhdr));
+            auto desc = name + ((nhdr->n_namesz + 3) & ~3);
+            if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 && std::memcmp(name, "GNU", 4) == 0) {
+                hasher << std::string(desc, nhdr->n_descsz);
+                return 0;
+            }
+            note = desc + ((nhdr->n_descsz + 3) & ~3);
+        }
+    }
+
+    // no build ID - the executable has an empty name here
+    std::string path = info->dlpi_name[0] != '\0' ? info->dlpi_name : "/proc/self/exe";
+    struct stat st;
+    hasher << path;
+    if (stat(path.c_str(), &st) == 0)
+        hasher << int64_t(st.st_size) << int64_t(st.st_mtime);
+    return 0;
+}
+#endif
+
+std::string build_id() {
+    Hasher hasher;
+#ifdef __linux__
+    dl_iterate_phdr(add_object, &hasher);
+#endif
+    // without information about the loaded objects at least distinguish builds of this file
+    hasher << __DATE__ " " __TIME__;
+    return hasher.hash();
+}
+
+//------------------------------------------------------------------------------
+
+/*
+ * OutputCache
+ */
+
+static std::string read_file(const std::string& name, bool& ok) {
+    std::ifstream file(name, std::ios::binary);
+    ok = bool(file);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+OutputCache::OutputCache(const std::string& dir, const std::string& key)
+    : dir_(dir)
+    , path_(dir + "/" + key + ".cache")
+{}
+
+bool OutputCache::restore(const std::string& module_name) const {
+    std::ifstream entry(path_, std::ios::binary);
+    if (!entry)
+        return false;
+
+    // read everything first so that a truncated entry doesn't leave half of the files behind
+    std::vector<std::pair<std::string, std::string>> files;
+    size_t num;
+    if (!(entry >> num) || entry.get() != '\n')
+        return false;
+    for (size_t i = 0; i != num; ++i) {
+        std::string ext;
+        size_t size;
+        if (!(entry >> ext >> size) || entry.get() != '\n')
+            return false;
+        std::string contents(size, '\0');
+        if (size != 0 && !entry.read(&contents[0], size))
+            return false;
+        files.emplace_back(std::move(ext), std::move(contents));
+    }
+
+    for (const auto& file : files) {
+        auto name = module_name + file.first;
+        std::ofstream out(name, std::ios::binary);
+        if (!out.write(file.second.data(), file.second.size()))
+            throw std::runtime_error("cannot write '" + name + "': " + strerror(errno));
+    }
+    return true;
+}
+
+void OutputCache::store(const std::string& module_name, const std::vector<std::string>& exts) const {
+#ifdef _WIN32
+    _mkdir(dir_.c_str());
+#else
+    mkdir(dir_.c_str(), 0777);
+#endif
+
+    // write to a temporary file and rename it so that concurrent compilers never see partial entries
+    auto tmp = path_ + ".tmp" + std::to_string(std::random_device()());
+    {
+        std::ofstream entry(tmp, std::ios::binary);
+        if (!entry)
+            return; // caching is best effort
+        entry << exts.size() << '\n';
+        for (const auto& ext : exts) {
+            bool ok;
+            auto contents = read_file(module_name + ext, ok);
+            if (!ok) {
+                entry.close();
+                std::remove(tmp.c_str());
+                return;
+            }
+            entry << ext << ' ' << contents.size() << '\n';
+            entry.write(contents.data(), contents.size());
+        }
+        if (!entry) {
+            entry.close();
+            std::remove(tmp.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmp.c_str(), path_.c_str()) != 0) {
+        std::remove(path_.c_str()); // rename doesn't replace existing files on all platforms
+        if (std::rename(tmp.c_str(), path_.c_str()) != 0)
+            std::remove(tmp.c_str());
+    }
+}
+
+}
@@ -0,0 +1,64 @@
+#ifndef IMPALA_CACHE_H
+#define IMPALA_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace impala {
+
+/// Incremental SHA-256 hash of a sequence of strings and numbers.
+class Hasher {
+public:
+    Hasher();
+
+    Hasher& operator<<(const std::string& s) {
+        // hash the length as well so that "ab" "c" and "a" "bc" differ
+        add(std::to_string(s.size()) + ':');
+        add(s);
+        return *this;
+    }
+    Hasher& operator<<(const char* s) { return *this << std::string(s); }
+    Hasher& operator<<(int64_t i) { return *this << std::to_string(i); }
+    Hasher& operator<<(bool b) { return *this << int64_t(b); }
+
+    /// Digest of everything added so far as 64 hex digits.
+    std::string hash() const;
+
+private:
+    void add(const std::string& s);
+    void compress(const unsigned char* block);
+
+    uint32_t state_[8];
+    unsigned char block_[64];
+    uint64_t size_ = 0; ///< Number of bytes added so far.
+};
+
+/**
+ * Identifies the code of this compiler: the build IDs of the executable and of all libraries loaded into it.
+ * Objects without build ID are identified by their path, size and modification time.
+ */
+std::string build_id();
+
+/**
+ * Content-addressed store for the output files of a compilation.
+ * An entry is a single file in the cache directory named after its key.
+ * It holds all output files as (extension, contents) pairs.
+ */
+class OutputCache {
+public:
+    OutputCache(const std::string& dir, const std::string& key);
+
+    /// Restores all files of the entry as @p module_name + extension; returns false on a miss.
+    bool restore(const std::string& module_name) const;
+    /// Stores the files @p module_name + @p exts as new entry.
+    void store(const std::string& module_name, const std::vector<std::string>& exts) const;
+
+private:
+    std::string dir_;
+    std::string path_;
+};
+
+}
+
+#endif
@@ -1,6 +1,8 @@
+#include <algorithm>
+#include <cassert>
+#include <cctype>
 #include <fstream>
 #include <string>
-#include <cassert>
 
 #include "thorin/util/hash.h"
 #include "thorin/util/location.h"
@@ -23,14 +25,41 @@ private:
             f(struct_type->struct_decl());
         else if (auto ptr_type = type->isa<PtrType>())
             struct_from_type(ptr_type->pointee(), f);
-        else if (auto array_type = type->isa<ArrayType>())
+        else if (auto array_type = type->isa<ArrayType>()) {
             struct_from_type(array_type->elem_type(), f);
+            if (is_soa(array_type) && std::find(export_soas.begin(), export_soas.end(), array_type) == export_soas.end())
+                export_soas.push_back(array_type->as<DefiniteArrayType>());
+        }
+        else if (auto slice_type = type->isa<SliceType>()) {
+            struct_from_type(slice_type->elem_type(), f);
+            // elements first so that slices of slices are generated in order
+            // mutability and address space do not show up in C, so only the element type counts
+            auto same_elem = [&] (const SliceType* other) { return other->elem_type() == slice_type->elem_type(); };
+            if (std::none_of(export_slices.begin(), export_slices.end(), same_elem))
+                export_slices.push_back(slice_type);
+        }
         else if (auto fn_type = type->isa<FnType>()) {
             for (size_t i = 0, e = fn_type->num_params(); i != e; ++i)
                 struct_from_type(fn_type->param(i), f);
         }
     }
 
+    // Name of the C structure of a slice type, e.g. slice_int for slice[i32]
+    static bool slice_name(const SliceType* slice_type, std::string& name) {
+        std::string elem_pref, elem_suf;
+        if (!ctype_from_impala(slice_type->elem_type(), elem_pref, elem_suf) || !elem_suf.empty())
+            return false;
+        name = "slice_";
+        for (auto c : elem_pref)
+            name += c == '*' ? 'p' : std::isalnum(c) ? c : '_';
+        return true;
+    }
+
+    // Name of the C structure of a #[soa] array, e.g. Body_soa_16 for [Body * 16]
+    static std::string soa_name(const DefiniteArrayType* array_type) {
+        return array_type->elem_type()->as<StructType>()->struct_decl()->symbol().str() + "_soa_" + std::to_string(array_type->dim());
+    }
+
     // Generates a C type from an Impala type
     static bool ctype_from_impala(const Type* type, std::string& ctype_prefix, std::string& ctype_suffix) {
         if (auto prim_type = type->isa<PrimType>()) {
@@ -110,6 +139,16 @@ private:
             return true;
         }
 
+        // Slices are passed as { T* ptr; size_t len; }
+        if (auto slice_type = type->isa<SliceType>()) {
+            std::string name;
+            if (!slice_name(slice_type, name))
+                return false;
+            ctype_prefix = "struct " + name;
+            ctype_suffix = "";
+            return true;
+        }
+
         // C void type is represented as an empty tuple (other tuples are not supported for interface generation)
         if (type->isa<TupleType>()) {
             ctype_prefix = "void";
@@ -122,9 +161,11 @@ private:
             // Rules :
             // &[T] -> T*
             // &[T * N] -> T*
+            // &[S * N] -> struct S_soa_N* for #[soa] structs S
             // &T -> T*
 
-            if (auto array_type = ptr_type->pointee()->isa<ArrayType>()) {
+            auto array_type = ptr_type->pointee()->isa<ArrayType>();
+            if (array_type && !is_soa(array_type)) {
                 if (!ctype_from_impala(array_type->elem_type(), ctype_prefix, ctype_suffix))
                     return false;
             } else {
@@ -138,6 +179,13 @@ private:
             return true;
         }
 
+        // #[soa] arrays are structures with one array per field
+        if (is_soa(type)) {
+            ctype_prefix = "struct " + soa_name(type->as<DefiniteArrayType>());
+            ctype_suffix = "";
+            return true;
+        }
+
         if (auto darray_type = type->isa<DefiniteArrayType>()) {
             if (!ctype_from_impala(darray_type->elem_type(), ctype_prefix, ctype_suffix))
                 return false;
@@ -205,10 +253,79 @@ private:
 
     thorin::GIDSet<const StructDecl*> export_structs;
     std::vector<const FnDecl*> export_fns;
+    std::vector<const SliceType*> export_slices;
+    std::vector<const DefiniteArrayType*> export_soas;
 
 public:
     bool needs_vectors = false;
 
+    bool needs_slices() const { return !export_slices.empty(); }
+
+    bool needs_layout_checks() const {
+        return std::any_of(export_structs.begin(), export_structs.end(), [] (const StructDecl* decl) { return has_layout_attrs(decl); });
+    }
+
+    static void generate_layout_check_macro(std::ostream& o) {
+        // C11 and C++11 spell static assertions differently
+        o << "#ifndef IMPALA_STATIC_ASSERT\n"
+          << "#ifdef __cplusplus\n"
+          << "#define IMPALA_STATIC_ASSERT(cond, msg) static_assert(cond, msg)\n"
+          << "#else\n"
+          << "#define IMPALA_STATIC_ASSERT(cond, msg) _Static_assert(cond, msg)\n"
+          << "#endif\n"
+          << "#endif\n" << std::endl;
+    }
+
+    // Whether the layout of the type depends on the size of pointers
+    static bool has_ptr_layout(const Type* type) {
+        if (type->isa<PtrType>())
+            return true;
+        return std::any_of(type->ops().begin(), type->ops().end(), [] (const Type* op) { return has_ptr_layout(op); });
+    }
+
+    // Checks that the C compiler lays out the structure like Impala does
+    static void generate_layout_checks(std::ostream& o, const StructDecl* decl) {
+        StructLayout layout;
+        if (!struct_layout(decl->struct_type(), layout))
+            return;
+        // Impala assumes 8 byte pointers: on other targets the layout differs anyway and the checks would only fail
+        auto ptr_layout = has_ptr_layout(decl->struct_type());
+        if (ptr_layout)
+            o << "#if UINTPTR_MAX == 0xffffffffffffffffu\n";
+        auto name = decl->symbol().str();
+        o << "IMPALA_STATIC_ASSERT(sizeof(struct " << name << ") == " << layout.size
+          << ", \"size of struct " << name << "\");\n";
+        for (const auto& field : decl->field_decls()) {
+            o << "IMPALA_STATIC_ASSERT(offsetof(struct " << name << ", " << field->symbol() << ") == " << layout.offsets[field->index()]
+              << ", \"offset of " << name << "::" << field->symbol() << "\");\n";
+        }
+        if (ptr_layout)
+            o << "#endif\n";
+        o << std::endl;
+    }
+
+    void generate_slices(std::ostream& o) const {
+        // slices only hold pointers, so their elements may be declared later
+        for (auto slice_type : export_slices) {
+            std::string name, elem_pref, elem_suf;
+            // unexportable slices are reported where they are used
+            if (!slice_name(slice_type, name))
+                continue;
+            ctype_from_impala(slice_type->elem_type(), elem_pref, elem_suf);
+
+            // the same slice type may be defined by several interface files
+            std::string guard = "IMPALA_" + name;
+            std::transform(guard.begin(), guard.end(), guard.begin(), ::toupper);
+            o << "#ifndef " << guard << "\n"
+              << "#define " << guard << "\n"
+              << "struct " << name << " {\n"
+              << "    " << elem_pref << "* ptr;\n"
+              << "    size_t len;\n"
+              << "};\n"
+              << "#endif\n" << std::endl;
+        }
+    }
+
     void process_module(const Module* mod) {
         for (const auto& item : mod->items()) {
             if (auto block = item->isa<ExternBlock>()) {
@@ -264,7 +381,15 @@ public:
         assert(order.size() == export_structs.size());
 
         for (auto st : order) {
-            o << "struct " << st->symbol().str() << " {\n";
+            auto has_layout = has_layout_attrs(st);
+            o << "struct ";
+            if (st->attr("packed") && st->attr("align"))
+                o << "__attribute__((packed, aligned(" << st->attr("align")->arg(0) << "))) ";
+            else if (st->attr("packed"))
+                o << "__attribute__((packed)) ";
+            else if (st->attr("align"))
+                o << "__attribute__((aligned(" << st->attr("align")->arg(0) << "))) ";
+            o << st->symbol().str() << " {\n";
             for (const auto& field : st->field_decls()) {
                 auto type = field->type();
 
@@ -273,10 +398,31 @@ public:
                     error(field.get(), "structure field type not exportable");
                     return false;
                 }
-
-                o << "    " << ctype_pref << ' ' << field->symbol() << ctype_suf << ";\n";
+                // bool takes a single byte in Impala
+                if (has_layout && is_bool(type))
+                    ctype_pref = "unsigned char";
+
+                o << "    " << ctype_pref << ' ' << field->symbol() << ctype_suf;
+                if (auto align = field->attr("align"))
+                    o << " __attribute__((aligned(" << align->arg(0) << ")))";
+                o << ";\n";
             }
             o << "};\n" << std::endl;
+
+            if (has_layout)
+                generate_layout_checks(o, st);
+
+            for (auto soa : export_soas) {
+                if (soa->elem_type()->as<StructType>()->struct_decl() != st)
+                    continue;
+                o << "struct " << soa_name(soa) << " {\n";
+                for (const auto& field : st->field_decls()) {
+                    std::string ctype_pref, ctype_suf;
+                    ctype_from_impala(field->type(), ctype_pref, ctype_suf);
+                    o << "    " << ctype_pref << ' ' << field->symbol() << '[' << soa->dim() << ']' << ctype_suf << ";\n";
+                }
+                o << "};\n" << std::endl;
+            }
         }
 
         return true;
@@ -348,6 +494,15 @@ bool generate_c_interface(const Module* mod, const CGenOptions& opts, std::ostre
         o << "#include <immintrin.h>\n" << std::endl;
     }
 
+    if (cgen.needs_slices() || (!opts.fns_only && cgen.needs_layout_checks()))
+        o << "#include <stddef.h>\n" << std::endl;
+    if (!opts.fns_only && cgen.needs_layout_checks())
+        o << "#include <stdint.h>\n" << std::endl;
+    if (!opts.fns_only && cgen.needs_layout_checks())
+        cgen.generate_layout_check_macro(o);
+    if (cgen.needs_slices())
+        cgen.generate_slices(o);
+
     // Export structures
     if (!opts.fns_only && !cgen.generate_structs(o)) {
         return false;
@@ -0,0 +1,39 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "impala/server.h"
+
+// Drop-in replacement for impala which forwards its command line to a compile server.
+// The socket is taken from IMPALA_SERVER; without a running server impala is invoked directly.
+int main(int argc, char** argv) {
+    try {
+        auto env = std::getenv("IMPALA_SERVER");
+        std::string socket = env != nullptr ? env : impala::default_socket();
+
+        impala::CompileRequest request;
+        char cwd[4096];
+        if (getcwd(cwd, sizeof(cwd)) == nullptr)
+            throw std::runtime_error(std::string("cannot determine working directory: ") + strerror(errno));
+        request.cwd = cwd;
+        request.args.assign(argv, argv + argc);
+
+        impala::CompileResponse response;
+        if (!impala::request(socket, request, response)) {
+            argv[0] = const_cast<char*>("impala");
+            execvp(argv[0], argv);
+            throw std::runtime_error("no compile server at '" + socket + "' and cannot run impala: " + strerror(errno));
+        }
+
+        std::cout << response.out << std::flush;
+        std::cerr << response.err << std::flush;
+        return response.status;
+    } catch (std::exception const& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
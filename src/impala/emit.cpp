@@ -1,3 +1,10 @@
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+
 #include "impala/ast.h"
 
 #include "thorin/irbuilder.h"
@@ -11,11 +18,57 @@ using namespace thorin;
 
 namespace impala {
 
+/// Floating-point transformations which may change results, enabled by @c -ffast-math or attributes of functions and blocks.
+enum FastMath : unsigned {
+    FastMath_reassoc  = 1 << 0,
+    FastMath_contract = 1 << 1,
+    FastMath_nnan     = 1 << 2,
+    FastMath_ninf     = 1 << 3,
+    FastMath_arcp     = 1 << 4,
+    FastMath_all      = (1 << 5) - 1,
+};
+
+/// @p FastMath flags enabled by the attributes of @p attrs.
+static unsigned fast_math_flags(const AttrList* attrs) {
+    if (attrs->attr("fast_math"))
+        return FastMath_all;
+    unsigned flags = 0;
+    if (attrs->attr("reassoc"))  flags |= FastMath_reassoc;
+    if (attrs->attr("contract")) flags |= FastMath_contract;
+    if (attrs->attr("nnan"))     flags |= FastMath_nnan;
+    if (attrs->attr("ninf"))     flags |= FastMath_ninf;
+    if (attrs->attr("arcp"))     flags |= FastMath_arcp;
+    return flags;
+}
+
+/**
+ * The hints of @p loop for LLVM like <tt>.unroll4.vectorize8</tt> - empty if there are none.
+ * A plain <tt>#[unroll]</tt> unrolls a for loop completely via partial evaluation instead.
+ */
+static std::string loop_hints(const AttrList* loop) {
+    std::string hints;
+    if (auto unroll = loop->attr("unroll")) {
+        if (unroll->num_args() == 1)
+            hints += ".unroll" + std::to_string(unroll->arg(0));
+    }
+    if (loop->attr("no_unroll"))
+        hints += ".nounroll";
+    if (auto vectorize = loop->attr("vectorize"))
+        hints += ".vectorize" + (vectorize->num_args() == 1 ? std::to_string(vectorize->arg(0)) : std::string());
+    if (loop->attr("parallel"))
+        hints += ".parallel";
+    return hints;
+}
+
 class CodeGen : public IRBuilder {
 public:
-    CodeGen(World& world)
+    CodeGen(World& world, LLVMAnnotations& annotations, bool bounds_checks, bool ffast_math)
         : IRBuilder(world)
         , empty_fn_type(world.fn_type({ world.mem_type() }))
+        , annotations(annotations)
+        , bounds_checks(bounds_checks)
+        , default_fast_math(ffast_math ? FastMath_all : 0)
+        , fast_math(default_fast_math)
     {}
 
     const Def* frame() const { assert(cur_fn); return cur_fn->frame(); }
@@ -38,6 +91,7 @@ public:
         auto result = continuation(convert(decl->type())->as<thorin::FnType>(), decl->debug());
         result->param(0)->debug().set("mem");
         decl->value_ = Value::create_val(*this, result);
+        decls_.push_back(decl);
         return result;
     }
 
@@ -52,6 +106,371 @@ public:
         set_continuation(continuation);
     }
 
+    /**
+     * Calls the pseudo function @p name with @p args; @c finish_llvm replaces the call with the LLVM instruction it stands for.
+     * Returns the result of type @p ret_type or the empty tuple if @p ret_type is null.
+     */
+    const Def* call_pseudo(const std::string& name, Defs args, const thorin::Type* ret_type, const thorin::Location& loc) {
+        Array<const thorin::Type*> types(args.size() + 2);
+        types.front() = world().mem_type();
+        for (size_t i = 0, e = args.size(); i != e; ++i)
+            types[i + 1] = args[i]->type();
+        types.back() = ret_type ? world().fn_type({ world().mem_type(), ret_type }) : empty_fn_type;
+        auto cont = world().continuation(world().fn_type(types), {loc, name});
+        cont->cc() = thorin::CC::Device;
+
+        Array<const Def*> defs(args.size() + 1);
+        defs.front() = get_mem();
+        std::copy(args.begin(), args.end(), defs.begin() + 1);
+        auto ret = call(cont, defs, ret_type ? ret_type : world().tuple_type({}), thorin::Debug(loc, name) + "_cont");
+        set_mem(cur_bb->param(0));
+        return ret_type ? ret : world().tuple({}, loc);
+    }
+
+    /**
+     * Marks the loop around the current block with @p hints via the pseudo function <tt>impala.loop.HINTS</tt>;
+     * @c finish_llvm attaches them as @c llvm.loop metadata to the innermost LLVM loop around the call.
+     */
+    void mark_loop(const std::string& hints, const thorin::Location& loc) {
+        if (!hints.empty() && is_reachable())
+            call_pseudo("impala.loop" + hints, {}, nullptr, loc);
+    }
+
+    /// Tells LLVM via @c llvm.assume that @p ptr is aligned as its @p type promises.
+    void assume_aligned(const Def* ptr, const PtrType* type, const thorin::Location& loc) {
+        if (type->align() <= 1 || !is_reachable())
+            return;
+        auto addr = world().cast(world().type_pu64(), ptr, loc);
+        auto low_bits = world().arithop_and(addr, world().literal_pu64(type->align() - 1, loc), loc);
+        auto cond = world().cmp_eq(low_bits, world().literal_pu64(0, loc), loc);
+        auto assume = world().continuation(world().fn_type({world().mem_type(), world().type_bool(), empty_fn_type}), {loc, "llvm.assume"});
+        assume->cc() = thorin::CC::Device;
+        call(assume, {get_mem(), cond}, world().tuple_type({}), thorin::Debug(loc, "llvm.assume") + "_cont");
+        set_mem(cur_bb->param(0));
+    }
+
+    /// Unsigned comparison of the @c i64 values @p a and @p b - negative values are out of bounds.
+    const Def* cmp_bounds(const Def* a, const Def* b, bool inclusive, const thorin::Location& loc) {
+        auto ua = world().cast(world().type_pu64(), a, loc);
+        auto ub = world().cast(world().type_pu64(), b, loc);
+        return inclusive ? world().cmp_le(ua, ub, loc) : world().cmp_lt(ua, ub, loc);
+    }
+
+    /// Calls @c llvm.trap unless @p cond holds; nothing is emitted if bounds checks are disabled.
+    void check_bounds(const Def* cond, const thorin::Location& loc) {
+        if (!bounds_checks || !is_reachable())
+            return;
+        JumpTarget ok_bb({loc, "bounds_ok"});
+        JumpTarget fail_bb({loc, "bounds_fail"});
+        branch(cond, ok_bb, fail_bb, loc);
+        if (enter(fail_bb)) {
+            auto trap = world().continuation(world().fn_type({world().mem_type(), empty_fn_type}), {loc, "llvm.trap"});
+            trap->cc() = thorin::CC::Device;
+            call(trap, {get_mem()}, world().tuple_type({}), thorin::Debug(loc, "llvm.trap") + "_cont");
+            set_mem(cur_bb->param(0));
+            jump(ok_bb, loc);
+        }
+        enter(ok_bb);
+    }
+
+    /// Stores @p count copies of @p value to the array @p ptr points to with a loop.
+    void fill(const Def* ptr, const Def* value, uint64_t count, const thorin::Location& loc) {
+        auto index = world().slot(world().type_pu64(), frame(), {loc, "fill_index"});
+        store(index, world().literal_pu64(0, loc), loc);
+        JumpTarget head_bb({loc, "fill_head"});
+        JumpTarget body_bb({loc, "fill_body"});
+        JumpTarget exit_bb({loc, "fill_exit"});
+
+        jump(head_bb, loc);
+        enter_unsealed(head_bb);
+        auto i = load(index, loc);
+        branch(world().cmp_lt(i, world().literal_pu64(count, loc), loc), body_bb, exit_bb, loc);
+        if (enter(body_bb)) {
+            store(world().lea(ptr, i, loc), value, loc);
+            store(index, world().arithop_add(i, world().literal_pu64(1, loc), loc), loc);
+        }
+        jump(head_bb, loc);
+        head_bb.seal();
+        enter(exit_bb);
+    }
+
+    /**
+     * Rewrites the arguments @p defs of a call of thorin's parallel primop - mem, number of threads, lower, upper, body and return -
+     * so that each iteration runs a chunk of @p chunk iterations of the loop.
+     * With the chunked schedule the runtime distributes the chunks among its threads like any other iterations.
+     * With the dynamic one each iteration claims chunks from a counter in the caller's frame until none is left:
+     * the first iteration of each thread keeps it busy, the others find the counter exhausted.
+     * A @p chunk of 0 splits the loop into 64 chunks.
+     */
+    void schedule_parallel(std::vector<const Def*>& defs, bool dynamic, uint64_t chunk, const thorin::Location& loc) {
+        auto lower = defs[2], upper = defs[3], body = defs[4];
+        auto fn_type = body->type()->as<thorin::FnType>();
+        auto i32 = world().type_qs32();
+        auto zero = world().literal_qs32(0, loc);
+        auto one = world().literal_qs32(1, loc);
+        auto size = world().select(world().cmp_lt(lower, upper, loc), world().arithop_sub(upper, lower, loc), zero, loc);
+        auto step = chunk != 0 ? world().literal_qs32(int32_t(chunk), loc)
+                               : world().select(world().cmp_lt(size, world().literal_qs32(64, loc), loc), one,
+                                                world().arithop_div(size, world().literal_qs32(64, loc), loc), loc);
+        auto rest = world().select(world().cmp_eq(world().arithop_rem(size, step, loc), zero, loc), zero, one, loc);
+        auto num_chunks = world().arithop_add(world().arithop_div(size, step, loc), rest, loc);
+
+        // run_chunk(mem, c, ret) calls body for [lower + c * step, min(lower + (c + 1) * step, upper))
+        auto run_chunk = world().continuation(fn_type, {loc, "run_chunk"});
+        auto head = world().continuation(world().fn_type({world().mem_type(), i32}), {loc, "chunk_head"});
+        auto iter = world().continuation(world().fn_type({}), {loc, "chunk_iter"});
+        auto next = world().continuation(world().fn_type({world().mem_type()}), {loc, "chunk_next"});
+        auto exit = world().continuation(world().fn_type({}), {loc, "chunk_exit"});
+        auto begin = world().arithop_add(lower, world().arithop_mul(run_chunk->param(1), step, loc), loc);
+        auto end = world().select(world().cmp_lt(step, world().arithop_sub(upper, begin, loc), loc), world().arithop_add(begin, step, loc), upper, loc);
+        run_chunk->jump(head, {run_chunk->param(0), begin}, loc);
+        head->branch(world().cmp_lt(head->param(1), end, loc), iter, exit, loc);
+        iter->jump(body, {head->param(0), head->param(1), next}, loc);
+        next->jump(head, {next->param(0), world().arithop_add(head->param(1), one, loc)}, loc);
+        exit->jump(run_chunk->param(2), {head->param(0)}, loc);
+
+        defs[2] = zero;
+        defs[3] = num_chunks;
+        defs[4] = run_chunk;
+        if (!dynamic)
+            return;
+
+        // claim(mem, j, ret) runs the chunks it takes from counter with an atomic add until all are taken
+        auto counter = world().slot(i32, frame(), {loc, "next_chunk"});
+        store(counter, zero, loc);
+        auto claim = world().continuation(fn_type, {loc, "claim_chunks"});
+        auto take = world().continuation(world().fn_type({world().mem_type()}), {loc, "take_chunk"});
+        auto taken = world().continuation(world().fn_type({world().mem_type(), i32}), {loc, "chunk_taken"});
+        auto run = world().continuation(world().fn_type({}), {loc, "run_taken"});
+        auto done = world().continuation(world().fn_type({}), {loc, "chunks_done"});
+        auto atomic = world().continuation(world().fn_type({world().mem_type(), world().type_pu32(), counter->type(), i32, taken->type()}), {loc, "atomic"});
+        atomic->set_intrinsic();
+        claim->jump(take, {claim->param(0)}, loc);
+        take->jump(atomic, {take->param(0), world().literal_pu32(1 /*add*/, loc), counter, one, taken}, loc);
+        taken->branch(world().cmp_lt(taken->param(1), num_chunks, loc), run, done, loc);
+        run->jump(run_chunk, {taken->param(0), taken->param(1), take}, loc);
+        done->jump(claim->param(2), {taken->param(0)}, loc);
+        defs[4] = claim;
+    }
+
+    /**
+     * @p count copies of @p value built by repeated doubling: a tuple of <tt>[[[value * 2] * 2] ...]</tt> for each bit set in @p count.
+     * It has the memory layout of <tt>[value * count]</tt> but only O(log count) defs.
+     */
+    const Def* compact_array(const Def* value, uint64_t count, const thorin::Location& loc) {
+        std::vector<const Def*> parts;
+        for (auto power = value; count != 0; count >>= 1) {
+            if (count & 1)
+                parts.push_back(power);
+            if (count > 1)
+                power = world().definite_array({power, power}, loc);
+        }
+        return parts.size() == 1 ? parts.front() : world().tuple(parts, loc);
+    }
+
+    /// Emits @p local as stack slot filled by the repeated array literal @p init.
+    void emit_filled(const LocalDecl* local, const RepeatedDefiniteArrayExpr* init) {
+        local->value_ = Value::create_ptr(*this, filled_slot(init, local->debug()));
+        decls_.push_back(local);
+    }
+
+    /// A new stack slot filled by the repeated array literal @p init.
+    const Def* filled_slot(const RepeatedDefiniteArrayExpr* init, thorin::Debug dbg) {
+        auto slot = world().slot(convert(init->type()), frame(), dbg);
+        auto value = remit(init->value());
+        if (is_soa(init->type())) {
+            auto struct_type = init->value()->type();
+            for (size_t i = 0, e = struct_type->num_ops(); i != e; ++i) {
+                auto column = world().lea(slot, world().literal_qu32(i, init->location()), init->location());
+                fill(column, extract_field(value, struct_type, i, init->location()), count(init), init->location());
+            }
+        } else {
+            fill(slot, value, count(init), init->location());
+        }
+        return slot;
+    }
+
+    /// Number of elements of @p repeated - its count may be a const type parameter of the instance being emitted.
+    uint64_t count(const RepeatedDefiniteArrayExpr* repeated) {
+        return instantiate(repeated->type())->as<DefiniteArrayType>()->dim();
+    }
+
+    /// Builds the <tt>#[soa]</tt> array of @p type from the struct values @p elems: a tuple with one array per field.
+    const Def* soa_array(const Type* type, Defs elems, const thorin::Location& loc) {
+        auto columns = convert(type)->as<thorin::TupleType>();
+        auto struct_type = type->as<DefiniteArrayType>()->elem_type();
+        Array<const Def*> fields(columns->num_ops());
+        for (size_t i = 0, e = fields.size(); i != e; ++i) {
+            Array<const Def*> column(elems.size());
+            for (size_t j = 0, n = elems.size(); j != n; ++j)
+                column[j] = extract_field(elems[j], struct_type, i, loc);
+            fields[i] = world().definite_array(columns->op(i)->as<thorin::DefiniteArrayType>()->elem_type(), column, loc);
+        }
+        return world().tuple(fields, loc);
+    }
+
+    /// Returns @p expr if it is an element of a <tt>#[soa]</tt> array - such elements have no address of their own.
+    static const MapExpr* soa_elem(const Expr* expr) {
+        auto map = expr->isa<MapExpr>();
+        return map && is_soa(unpack_ref_type(map->lhs()->type())) ? map : nullptr;
+    }
+
+    /// The fields of the <tt>#[soa]</tt> array element @p map - each one lives in the array of its field.
+    std::vector<Value> soa_fields(const MapExpr* map) {
+        auto agg = lemit(map->lhs());
+        auto index = remit(map->arg(0));
+        auto struct_type = unpack_ref_type(map->lhs()->type())->as<DefiniteArrayType>()->elem_type();
+        std::vector<Value> fields;
+        for (size_t i = 0, e = struct_type->num_ops(); i != e; ++i)
+            fields.push_back(Value::create_agg(Value::create_agg(agg, world().literal_qu32(i, map->location())), index));
+        return fields;
+    }
+
+    /// How the fields of a struct with layout attributes map to the fields of its thorin struct.
+    struct FieldLowering {
+        std::vector<uint32_t> index; ///< Index of each field in the thorin struct which also has padding fields.
+        std::vector<uint64_t> bytes; ///< Size of each misaligned field which is stored as byte array, 0 for all others.
+    };
+
+    /// The @p FieldLowering of the struct @p type or @c nullptr if it has the default layout.
+    const FieldLowering* field_lowering(const Type* type) {
+        type = instantiate(type);
+        convert(type);
+        auto i = field_lowerings_.find(type->as<StructType>());
+        return i == field_lowerings_.end() ? nullptr : &i->second;
+    }
+
+    /// Do values of @p type contain fields stored as bytes? Mutable variables of such types live in memory.
+    bool has_byte_fields(const Type* type) {
+        type = instantiate(type);
+        if (type->isa<PtrType>() || type->isa<SliceType>() || type->isa<FnType>())
+            return false;
+        if (type->isa<StructType>()) {
+            auto lowering = field_lowering(type);
+            if (lowering && std::any_of(lowering->bytes.begin(), lowering->bytes.end(), [] (uint64_t n) { return n != 0; }))
+                return true;
+        }
+        for (auto op : type->ops()) {
+            if (has_byte_fields(op))
+                return true;
+        }
+        return false;
+    }
+
+    /// Unsigned integer type with @p num_bytes bytes.
+    const thorin::PrimType* bits_type(uint64_t num_bytes) {
+        switch (num_bytes) {
+            case 2:  return world().type_pu16();
+            case 4:  return world().type_pu32();
+            default: return world().type_pu64();
+        }
+    }
+
+    /// The bytes of the scalar @p def in little endian order - misaligned fields of packed structs are stored like this.
+    const Def* to_bytes(const Def* def, uint64_t num_bytes, const thorin::Location& loc) {
+        auto bits_type = this->bits_type(num_bytes);
+        auto bits = def->type()->isa<thorin::PtrType>() ? world().cast(bits_type, def, loc) : world().bitcast(bits_type, def, loc);
+        Array<const Def*> bytes(num_bytes);
+        for (uint64_t i = 0; i != num_bytes; ++i) {
+            auto shift = world().cast(bits_type, world().literal_pu64(8 * i, loc), loc);
+            bytes[i] = world().cast(world().type_pu8(), world().arithop_shr(bits, shift, loc), loc);
+        }
+        return world().definite_array(world().type_pu8(), bytes, loc);
+    }
+
+    /// The value of @p type stored by @p to_bytes in @p bytes.
+    const Def* from_bytes(const Def* bytes, const thorin::Type* type, uint64_t num_bytes, const thorin::Location& loc) {
+        auto bits_type = this->bits_type(num_bytes);
+        const Def* bits = world().zero(bits_type, loc);
+        for (uint64_t i = 0; i != num_bytes; ++i) {
+            auto byte = world().cast(bits_type, extract(bytes, i, loc), loc);
+            auto shift = world().cast(bits_type, world().literal_pu64(8 * i, loc), loc);
+            bits = world().arithop_or(bits, world().arithop_shl(byte, shift, loc), loc);
+        }
+        return type->isa<thorin::PtrType>() ? world().cast(type, bits, loc) : world().bitcast(type, bits, loc);
+    }
+
+    /// Field @p i of the value @p agg of the struct @p type.
+    const Def* extract_field(const Def* agg, const Type* type, uint32_t i, const thorin::Location& loc) {
+        auto lowering = field_lowering(type);
+        if (lowering == nullptr)
+            return extract(agg, i, loc);
+        auto field = extract(agg, lowering->index[i], loc);
+        if (auto num_bytes = lowering->bytes[i])
+            return from_bytes(field, convert(type->op(i)), num_bytes, loc);
+        return field;
+    }
+
+    /// Value of the struct @p type with the given @p fields.
+    const Def* struct_value(const Type* type, Defs fields, const thorin::Location& loc) {
+        auto struct_type = convert(type)->as<thorin::StructType>();
+        auto lowering = field_lowering(type);
+        if (lowering == nullptr)
+            return world().struct_agg(struct_type, fields, loc);
+        Array<const Def*> ops(struct_type->num_ops());
+        for (size_t i = 0, e = ops.size(); i != e; ++i)
+            ops[i] = world().bottom(struct_type->op(i), loc); // padding
+        for (size_t i = 0, e = fields.size(); i != e; ++i)
+            ops[lowering->index[i]] = lowering->bytes[i] ? to_bytes(fields[i], lowering->bytes[i], loc) : fields[i];
+        return world().struct_agg(struct_type, ops, loc);
+    }
+
+    /// Field @p i of the l-value @p agg of the struct @p type - misaligned fields are accessed with @p load_lvalue and @p store_lvalue.
+    Value field_value(Value agg, const Type* type, uint32_t i, const thorin::Location& loc) {
+        auto lowering = field_lowering(type);
+        return Value::create_agg(agg, world().literal_qu32(lowering ? lowering->index[i] : i, loc));
+    }
+
+    /// Size of the field the l-value @p expr refers to if it is misaligned and stored as bytes, 0 otherwise.
+    uint64_t byte_field(const Expr* expr) {
+        auto field = expr->isa<FieldExpr>();
+        if (field == nullptr || field->field_decl() == nullptr || soa_elem(field->lhs()))
+            return 0;
+        auto type = unpack_ref_type(field->lhs()->type());
+        auto lowering = type->isa<StructType>() ? field_lowering(type) : nullptr;
+        return lowering ? lowering->bytes[field->index()] : 0;
+    }
+
+    /// Loads @p var, the l-value of @p expr; a misaligned field is loaded as bytes which don't need any alignment.
+    const Def* load_lvalue(const Expr* expr, Value var, const thorin::Location& loc) {
+        auto def = var.load(loc);
+        if (auto num_bytes = byte_field(expr))
+            return from_bytes(def, convert(unpack_ref_type(expr->type())), num_bytes, loc);
+        return def;
+    }
+
+    /// Stores @p def to @p var, the l-value of @p expr.
+    void store_lvalue(const Expr* expr, Value var, const Def* def, const thorin::Location& loc) {
+        if (auto num_bytes = byte_field(expr))
+            def = to_bytes(def, num_bytes, loc);
+        var.store(def, loc);
+    }
+
+    /// Immutable global holding the constant @p def - shared by all uses of the same constant.
+    const Def* const_global(const Def* def, const thorin::Location& loc) {
+        auto& global = const_globals_[def];
+        if (global == nullptr)
+            global = world().global(def, /*mutable*/ false, loc);
+        return global;
+    }
+
+    /**
+     * Global of the definite array @p type holding @p bytes - shared by all immutable blobs with the same contents.
+     * thorin only sees the uninitialized global <tt>impala.blob.K</tt>; @c finish_llvm sets its bytes as single constant.
+     * It is mutable for thorin which would fold loads from it otherwise.
+     */
+    const Def* blob(const std::string& bytes, const thorin::Type* type, bool is_mut, const thorin::Location& loc) {
+        auto shared = is_mut ? nullptr : &blobs_[std::make_pair(type, bytes)];
+        if (shared && *shared)
+            return *shared;
+        auto name = "impala.blob." + std::to_string(annotations.blobs.size());
+        annotations.blobs.push_back({bytes, is_mut});
+        auto global = world().global(world().bottom(type, loc), /*mutable*/ true, {loc, name});
+        if (shared)
+            *shared = global;
+        return global;
+    }
+
     Value lemit(const Expr* expr) { return expr->lemit(*this); }
     const Def* remit(const Expr* expr) { return expr->remit(*this); }
     void emit_jump(const Expr* expr, JumpTarget& x) { if (is_reachable()) expr->emit_jump(*this, x); }
@@ -70,11 +489,164 @@ public:
         return decl->value_;
     }
     Value emit(const Decl* decl, const Def* init) {
-        if (!decl->value_)
+        if (!decl->value_) {
             decl->value_ = decl->emit(*this, init);
+            decls_.push_back(decl);
+        }
         return decl->value_;
     }
+
+    /**
+     * Substitutes the type arguments of the instance being emitted for the @p Var%s in @p type.
+     * Struct and enum types stay as they are: their fields can only mention their own type parameters (see @p convert_nominal).
+     */
+    const Type* instantiate(const Type* type) {
+        if (type_args_.empty())
+            return type;
+        if (auto var = type->isa<Var>())
+            return size_t(var->depth() - 1) < type_args_.size() ? type_args_[var->depth() - 1] : type;
+        if (type->num_ops() == 0 || type->isa<Lambda>() || type->isa<StructType>() || type->isa<EnumType>())
+            return type;
+
+        bool changed = false;
+        Array<const Type*> ops(type->num_ops());
+        for (size_t i = 0, e = ops.size(); i != e; ++i) {
+            ops[i] = instantiate(type->op(i));
+            changed |= ops[i] != type->op(i);
+        }
+        return changed ? type->rebuild(ops) : type;
+    }
+
+    /**
+     * Generic functions are emitted once per distinct list of type arguments.
+     * An instance of a function whose body is being emitted right now is only declared here and emitted afterwards.
+     * Polymorphic recursion asks for ever new instances; this stops with an error after @p max_instance_depth nested ones.
+     */
+    Continuation* instance(const FnDecl* fn_decl, Types type_args, const Location& location) {
+        // type arguments of enclosing generic functions stay the same
+        auto num_outer = std::min(type_args_.size(), size_t(fn_decl->ast_type_param(0)->lambda_depth() - 1));
+        std::vector<const Type*> args(type_args_.begin(), type_args_.begin() + num_outer);
+        for (auto type_arg : type_args)
+            args.push_back(instantiate(type_arg));
+
+        auto& continuation = instances_[std::make_pair(fn_decl, args)];
+        if (continuation == nullptr) {
+            THORIN_PUSH(type_args_, args);
+            continuation = world().continuation(convert(fn_decl->fn_type())->as<thorin::FnType>(),
+                                                {fn_decl->location(), fn_decl->fn_symbol().remove_quotation()});
+            annotate(fn_decl, continuation);
+            if (instance_depth_ == max_instance_depth) {
+                error(location, "instantiation depth limit of {} exceeded by '{}'", max_instance_depth, fn_decl->symbol());
+                return continuation;
+            }
+            pending_.emplace_back(fn_decl, args, continuation, instance_depth_ + 1);
+            if (!emitting_.count(fn_decl))
+                emit_pending(fn_decl);
+        }
+        return continuation;
+    }
+
+    /**
+     * Records the LLVM attributes of @p fn_decl and its @c noalias parameters for its @p continuation.
+     * Thorin would inline the function and lose them: the continuation is made external under a reserved name
+     * which @c finish_llvm turns back into an internal function.
+     */
+    void annotate(const FnDecl* fn_decl, Continuation* continuation) {
+        auto noinline = fn_decl->attr("noinline"), hot = fn_decl->attr("hot"), cold = fn_decl->attr("cold");
+        auto target_cpu = fn_decl->attr("target_cpu"), target_features = fn_decl->attr("target_features");
+        std::vector<size_t> noalias;
+        size_t num_ptrs = 0;
+        for (const auto& param : fn_decl->params()) {
+            if (instantiate(param->type())->isa<PtrType>()) {
+                if (param->is_noalias())
+                    noalias.push_back(num_ptrs);
+                ++num_ptrs;
+            }
+        }
+        if (!noinline && !hot && !cold && !target_cpu && !target_features && noalias.empty())
+            return;
+        if (fn_decl->abi() == "\"thorin\"" || fn_decl->abi() == "\"device\"")
+            return;
+
+        LLVMFnAnnotation annotation;
+        annotation.symbol = fn_decl->fn_symbol().remove_quotation().str();
+        annotation.internal = fn_decl->body() && !continuation->is_external();
+        annotation.name = annotation.internal ? "__impala_" + std::to_string(annotations.fns.size()) + "_" + annotation.symbol : annotation.symbol;
+        annotation.noinline = noinline != nullptr;
+        annotation.hot = hot != nullptr;
+        annotation.cold = cold != nullptr;
+        if (target_cpu && target_cpu->num_strs() == 1)
+            annotation.target_cpu = target_cpu->str(0);
+        if (target_features && target_features->num_strs() == 1)
+            annotation.target_features = target_features->str(0);
+        annotation.noalias = std::move(noalias);
+        if (annotation.internal) {
+            continuation->debug().set(annotation.name);
+            continuation->make_external();
+        }
+        annotations.fns.push_back(std::move(annotation));
+    }
+
+    /// Emits the bodies of all pending instances of @p fn_decl.
+    void emit_pending(const FnDecl* fn_decl) {
+        emitting_.insert(fn_decl);
+        for (auto i = pending_.begin(); i != pending_.end();) {
+            if (std::get<0>(*i) != fn_decl) {
+                ++i;
+                continue;
+            }
+            auto pending = *i;
+            pending_.erase(i);
+            THORIN_PUSH(type_args_, std::get<1>(pending));
+            THORIN_PUSH(instance_depth_, std::get<3>(pending));
+            auto num_decls = decls_.size();
+            fn_decl->emit_instance(*this, std::get<2>(pending), fn_decl->location());
+            // locals and nested items belong to this instance only
+            for (size_t j = num_decls, e = decls_.size(); j != e; ++j) {
+                if (!toplevel_.count(decls_[j]))
+                    decls_[j]->value_ = Value();
+            }
+            decls_.resize(num_decls);
+            i = pending_.begin();
+        }
+        emitting_.erase(fn_decl);
+    }
+
+    /// Collects all items that are emitted at most once regardless of instances.
+    void collect_toplevel(const Module* module) {
+        for (const auto& item : module->items()) {
+            toplevel_.insert(item.get());
+            if (auto nested = item->isa<Module>()) {
+                collect_toplevel(nested);
+            } else if (auto extern_block = item->isa<ExternBlock>()) {
+                for (const auto& fn_decl : extern_block->fn_decls())
+                    toplevel_.insert(fn_decl.get());
+            } else if (auto impl = item->isa<ImplItem>()) {
+                for (size_t i = 0, e = impl->num_methods(); i != e; ++i)
+                    toplevel_.insert(impl->method(i));
+            }
+        }
+    }
+
+    /// Number of functions and other values in @p module and its nested modules which were neither emitted as root nor on demand.
+    size_t num_skipped(const Module* module) const {
+        auto skipped = [&] (const Item* item) { return !is_emitted(item) && !is_instantiated(item); };
+        size_t num = 0;
+        for (const auto& item : module->items()) {
+            if (auto nested = item->isa<Module>()) {
+                num += num_skipped(nested);
+            } else if (auto impl = item->isa<ImplItem>()) {
+                for (size_t i = 0, e = impl->num_methods(); i != e; ++i)
+                    num += skipped(impl->method(i));
+            } else if (item->isa<ValueItem>()) {
+                num += skipped(item.get());
+            }
+        }
+        return num;
+    }
+
     const thorin::Type* convert(const Type* type) {
+        type = instantiate(type);
         if (auto t = thorin_type(type))
             return t;
         auto t = convert_rec(type);
@@ -82,16 +654,45 @@ public:
     }
 
     const thorin::Type* convert_rec(const Type*);
+    const thorin::Type* convert_nominal(const Type*);
+    const thorin::Type* convert_layout(const StructType*, const StructLayout&);
 
     const thorin::Type*& thorin_type(const Type* type) { return impala2thorin_[type]; }
     const thorin::StructType*& thorin_struct_type(const StructType* type) { return struct_type_impala2thorin_[type]; }
     const thorin::StructType*& thorin_enum_type(const EnumType* type) { return enum_type_impala2thorin_[type]; }
 
+    /// Has @p item been emitted - either as root or on demand?
+    static bool is_emitted(const Item* item) { return item->is_value_decl() && item->value_.tag() != thorin::Value::Empty; }
+    /// Has at least one instance of the generic @p item been emitted?
+    bool is_instantiated(const Item* item) const {
+        auto fn_decl = item->isa<FnDecl>();
+        auto i = fn_decl ? instances_.lower_bound(std::make_pair(fn_decl, std::vector<const Type*>())) : instances_.end();
+        return i != instances_.end() && i->first.first == fn_decl;
+    }
+
     const Fn* cur_fn = nullptr;
     const thorin::Type* empty_fn_type;
+    LLVMAnnotations& annotations;
+    bool bounds_checks; ///< Check indices and ranges of slices at run time.
+    unsigned default_fast_math; ///< @p FastMath flags of functions without attributes.
+    unsigned fast_math;         ///< @p FastMath flags of the code emitted right now.
+    std::string for_loop_hints; ///< Hints of the for loop whose body is emitted next - see @c mark_loop.
     TypeMap<const thorin::Type*> impala2thorin_;
     GIDMap<const StructType*, const thorin::StructType*> struct_type_impala2thorin_;
     GIDMap<const EnumType*,   const thorin::StructType*> enum_type_impala2thorin_;
+    GIDMap<const StructType*, FieldLowering> field_lowerings_;
+    std::map<std::pair<const thorin::Type*, int>, const thorin::StructType*> slice_types_; ///< By element type and address space.
+    thorin::DefMap<const Def*> const_globals_;
+    std::map<std::pair<const thorin::Type*, std::string>, const Def*> blobs_;
+    std::vector<const Type*> type_args_; ///< Substitution of the instance being emitted: @c type_args_[i] replaces the @p Var of depth i + 1.
+    std::map<std::pair<const FnDecl*, std::vector<const Type*>>, Continuation*> instances_;
+    std::vector<std::tuple<const FnDecl*, std::vector<const Type*>, Continuation*, int>> pending_; ///< With their instance depth.
+    static const int max_instance_depth = 64;
+    int instance_depth_ = 0; ///< Number of instances that led to the instance being emitted, including itself.
+    std::unordered_set<const FnDecl*> emitting_;
+    std::unordered_set<const TypeDeclItem*> generic_type_decls_; ///< Reported as not emittable.
+    std::vector<const Decl*> decls_;                ///< Decls in the order their values were set.
+    std::unordered_set<const Decl*> toplevel_;
 };
 
 /*
@@ -121,7 +722,54 @@ const thorin::Type* CodeGen::convert_rec(const Type* type) {
         for (const auto& op : tuple_type->ops())
             nops.push_back(convert(op));
         return world().tuple_type(nops);
-    } else if (auto struct_type = type->isa<StructType>()) {
+    } else if (type->isa<StructType>() || type->isa<EnumType>()) {
+        return convert_nominal(type);
+    } else if (auto ptr_type = type->isa<PtrType>()) {
+        return world().ptr_type(convert(ptr_type->pointee()), 1, -1, thorin::AddrSpace(ptr_type->addr_space()));
+    } else if (auto definite_array_type = type->isa<DefiniteArrayType>()) {
+        if (is_soa(definite_array_type)) {
+            auto struct_type = definite_array_type->elem_type();
+            Array<const thorin::Type*> columns(struct_type->num_ops());
+            for (size_t i = 0, e = columns.size(); i != e; ++i)
+                columns[i] = world().definite_array_type(convert(struct_type->op(i)), definite_array_type->dim());
+            return world().tuple_type(columns);
+        }
+        return world().definite_array_type(convert(definite_array_type->elem_type()), definite_array_type->dim());
+    } else if (auto indefinite_array_type = type->isa<IndefiniteArrayType>()) {
+        return world().indefinite_array_type(convert(indefinite_array_type->elem_type()));
+    } else if (auto simd_type = type->isa<SimdType>()) {
+        return world().type(convert(simd_type->elem_type())->as<thorin::PrimType>()->primtype_tag(), simd_type->dim());
+    } else if (auto slice_type = type->isa<SliceType>()) {
+        // mutability is only checked by sema: slice[T] and slice[mut T] share their representation
+        auto elem_type = convert(slice_type->elem_type());
+        auto& s = slice_types_[std::make_pair(elem_type, slice_type->addr_space())];
+        if (s == nullptr) {
+            auto struct_type = world().struct_type("slice", 2);
+            struct_type->set(0, world().ptr_type(world().indefinite_array_type(elem_type), 1, -1, thorin::AddrSpace(slice_type->addr_space())));
+            struct_type->set(1, world().type_qs64());
+            s = struct_type;
+        }
+        return s;
+    }
+    THORIN_UNREACHABLE;
+}
+
+/**
+ * Sema keeps a single type for a generic struct or enum whose fields mention its type parameters, whatever the type arguments:
+ * thorin can't emit such a type, so its use is reported once.
+ * The fields are converted outside of any instance as they can't mention the type parameters of a generic function.
+ */
+const thorin::Type* CodeGen::convert_nominal(const Type* type) {
+    auto decl = type->isa<StructType>() ? (const TypeDeclItem*) type->as<StructType>()->struct_decl()
+                                        : (const TypeDeclItem*) type->as<EnumType>()->enum_decl();
+    if (decl->num_ast_type_params() != 0 && generic_type_decls_.insert(decl).second)
+        error(decl, "generic {} '{}' can't be emitted as its type arguments are not tracked", type->isa<StructType>() ? "struct" : "enum", decl->symbol());
+    THORIN_PUSH(type_args_, std::vector<const Type*>());
+
+    if (auto struct_type = type->isa<StructType>()) {
+        StructLayout layout;
+        if (has_layout_attrs(struct_type->struct_decl()) && struct_layout(struct_type, layout))
+            return convert_layout(struct_type, layout);
         auto s = world().struct_type(struct_type->struct_decl()->symbol(), struct_type->num_ops());
         thorin_struct_type(struct_type) = s;
         thorin_type(type) = s;
@@ -146,18 +794,59 @@ const thorin::Type* CodeGen::convert_rec(const Type* type) {
         s->set(1, world().variant_type(ops));
         thorin_type(enum_type) = nullptr;
         return s;
-    } else if (auto ptr_type = type->isa<PtrType>()) {
-        return world().ptr_type(convert(ptr_type->pointee()), 1, -1, thorin::AddrSpace(ptr_type->addr_space()));
-    } else if (auto definite_array_type = type->isa<DefiniteArrayType>()) {
-        return world().definite_array_type(convert(definite_array_type->elem_type()), definite_array_type->dim());
-    } else if (auto indefinite_array_type = type->isa<IndefiniteArrayType>()) {
-        return world().indefinite_array_type(convert(indefinite_array_type->elem_type()));
-    } else if (auto simd_type = type->isa<SimdType>()) {
-        return world().type(convert(simd_type->elem_type())->as<thorin::PrimType>()->primtype_tag(), simd_type->dim());
     }
     THORIN_UNREACHABLE;
 }
 
+/**
+ * Structs with layout attributes get padding fields so that thorin's default layout puts each field at its offset.
+ * A leading empty array of a vector type raises the alignment if needed; misaligned fields are stored as bytes.
+ */
+const thorin::Type* CodeGen::convert_layout(const StructType* struct_type, const StructLayout& layout) {
+    auto& lowering = field_lowerings_[struct_type];
+    enum Kind { Field, Padding, Align };
+    std::vector<std::pair<Kind, uint64_t>> plan; // field index, bytes of padding or alignment
+    uint64_t end = 0, align = 1;
+    for (size_t i = 0, e = struct_type->num_ops(); i != e; ++i) {
+        uint64_t field_size, field_align;
+        type_layout(struct_type->op(i), field_size, field_align);
+        if (layout.offsets[i] > end)
+            plan.emplace_back(Padding, layout.offsets[i] - end);
+        lowering.index.push_back(plan.size());
+        lowering.bytes.push_back(layout.misaligned[i] ? field_size : 0);
+        if (!layout.misaligned[i])
+            align = std::max(align, field_align);
+        plan.emplace_back(Field, i);
+        end = layout.offsets[i] + field_size;
+    }
+    if (layout.size > end)
+        plan.emplace_back(Padding, layout.size - end);
+    if (layout.align > align) {
+        plan.emplace(plan.begin(), Align, layout.align);
+        for (auto& index : lowering.index)
+            ++index;
+    }
+
+    auto s = world().struct_type(struct_type->struct_decl()->symbol(), plan.size());
+    thorin_struct_type(struct_type) = s;
+    thorin_type(struct_type) = s;
+    for (size_t i = 0, e = plan.size(); i != e; ++i) {
+        auto n = plan[i].second;
+        switch (plan[i].first) {
+            case Field:
+                if (lowering.bytes[n] != 0)
+                    s->set(i, world().definite_array_type(world().type_pu8(), lowering.bytes[n]));
+                else
+                    s->set(i, convert(struct_type->op(n)));
+                break;
+            case Padding: s->set(i, world().definite_array_type(world().type_pu8(), n)); break;
+            case Align:   s->set(i, world().definite_array_type(world().type(thorin::PrimType_pu8, n), 0)); break;
+        }
+    }
+    thorin_type(struct_type) = nullptr; // will be set again by CodeGen's wrapper
+    return s;
+}
+
 /*
  * Decls and Function
  */
@@ -170,7 +859,7 @@ Value LocalDecl::emit(CodeGen& cg, const Def* init) const {
             value_.store(init, location());
     };
 
-    if (is_address_taken()) {
+    if (is_address_taken() || (is_mut() && cg.has_byte_fields(type()))) {
         value_ = Value::create_ptr(cg, cg.world().slot(thorin_type, cg.frame(), debug()));
         do_init();
     } else if (is_mut()) {
@@ -195,11 +884,21 @@ Continuation* Fn::emit_head(CodeGen& cg, Location location) const {
                                            {location, fn_symbol().remove_quotation()});
 }
 
+void Fn::emit_instance(CodeGen& cg, Continuation* continuation, Location location) const {
+    THORIN_PUSH(continuation_, continuation);
+    THORIN_PUSH(frame_, frame_);
+    THORIN_PUSH(ret_param_, ret_param_);
+    THORIN_PUSH(cg.fast_math, cg.default_fast_math);
+    emit_body(cg, location);
+}
+
 void Fn::emit_body(CodeGen& cg, Location location) const {
     // setup function nest
     continuation()->set_parent(cg.cur_bb);
     THORIN_PUSH(cg.cur_fn, this);
     THORIN_PUSH(cg.cur_bb, continuation());
+    // lambdas keep the flags of their surroundings
+    THORIN_PUSH(cg.fast_math, cg.fast_math | fast_math_flags(this));
 
     // setup memory + frame
     {
@@ -216,6 +915,11 @@ void Fn::emit_body(CodeGen& cg, Location location) const {
             cg.emit(param.get(), p);
         }
 
+        for (size_t j = 0, e = num_params(); j != e; ++j) {
+            if (auto ptr_type = param(j)->type()->isa<PtrType>())
+                cg.assume_aligned(continuation()->param(j + 1), ptr_type, location);
+        }
+
         assert(i == continuation()->num_params() || continuation()->type() == cg.empty_fn_type);
 
         if (continuation()->num_params() != 0
@@ -223,6 +927,10 @@ void Fn::emit_body(CodeGen& cg, Location location) const {
             ret_param_ = continuation()->params().back();
     }
 
+    // the body of a for loop becomes the body of the loop once thorin specialized the iterating function
+    cg.mark_loop(cg.for_loop_hints, location.front());
+    cg.for_loop_hints.clear();
+
     // descend into body
     auto def = cg.remit(body());
     if (def) {
@@ -241,7 +949,9 @@ void Fn::emit_body(CodeGen& cg, Location location) const {
     // now handle the filter
     {
         size_t i = 0;
-        auto global = pe_expr() ? cg.remit(pe_expr()) : cg.world().literal_bool(false, location);
+        // always_inline specializes every call just like an @ without condition
+        auto global = attr("always_inline") ? cg.world().literal_bool(true, location)
+                    : pe_expr() ? cg.remit(pe_expr()) : cg.world().literal_bool(false, location);
         Array<const Def*> filter(continuation()->num_params());
         filter[i++] = global; // mem param
 
@@ -270,22 +980,36 @@ void ValueItem::emit(CodeGen& cg) const {
     cg.emit(this, nullptr);
 }
 
-void Module::emit(CodeGen& cg) const {
-    for (const auto& item : items())
-        cg.emit(item.get());
+/**
+ * Roots of the reachability analysis.
+ * All other items are emitted on demand when a reachable item refers to them (see @p CodeGen::emit(const Decl*, const Def*)).
+ */
+static bool is_root(const Item* item) {
+    if (item->isa<Module>())
+        return true;
+    if (auto fn_decl = item->isa<FnDecl>()) {
+        // generic functions are only emitted as instances
+        if (fn_decl->num_ast_type_params() != 0 && fn_decl->body())
+            return false;
+        if (fn_decl->symbol() == "main" || (fn_decl->is_extern() && fn_decl->body()))
+            return true;
+    }
+    return item->visibility().is_pub();
 }
 
-static bool is_primop(const Symbol& name) {
-    if      (name == "select")   return true;
-    else if (name == "sizeof")   return true;
-    else if (name == "bitcast")  return true;
-    else if (name == "insert")   return true;
-    return false;
+void Module::emit(CodeGen& cg) const {
+    for (const auto& item : items()) {
+        if (is_root(item.get()))
+            cg.emit(item.get());
+    }
 }
 
 Value FnDecl::emit(CodeGen& cg, const Def*) const {
     // no code is emitted for primops
-    if (is_extern() && abi() == "\"thorin\"" && is_primop(symbol()))
+    if (is_primop())
+        return value_;
+    // generic functions are emitted per instance - see CodeGen::instance
+    if (num_ast_type_params() != 0 && body())
         return value_;
 
     // create thorin function
@@ -298,22 +1022,25 @@ Value FnDecl::emit(CodeGen& cg, const Def*) const {
         continuation()->make_external();
     }
 
-    if (body())
+    // calling convention of external declarations - done here as they may be emitted on demand
+    if (abi() == "\"C\"")
+        continuation()->cc() = thorin::CC::C;
+    else if (abi() == "\"device\"")
+        continuation()->cc() = thorin::CC::Device;
+    else if (abi() == "\"thorin\"")
+        continuation()->set_intrinsic();
+    cg.annotate(this, continuation());
+
+    if (body()) {
+        THORIN_PUSH(cg.fast_math, cg.default_fast_math);
         emit_body(cg, location());
+    }
     return value_;
 }
 
 void ExternBlock::emit(CodeGen& cg) const {
-    for (const auto& fn_decl : fn_decls()) {
+    for (const auto& fn_decl : fn_decls())
         cg.emit(fn_decl.get(), nullptr); // TODO use init
-        auto continuation = fn_decl->continuation();
-        if (abi() == "\"C\"")
-            continuation->cc() = thorin::CC::C;
-        else if (abi() == "\"device\"")
-            continuation->cc() = thorin::CC::Device;
-        else if (abi() == "\"thorin\"" && continuation) // no continuation for primops
-            continuation->set_intrinsic();
-    }
 }
 
 void ModuleDecl::emit(CodeGen&) const {
@@ -329,6 +1056,7 @@ void ImplItem::emit(CodeGen& cg) const {
         args[i] = method(i)->continuation();
     }
 
+    THORIN_PUSH(cg.fast_math, cg.default_fast_math);
     for (size_t i = 0, e = args.size(); i != e; ++i)
         method(i)->emit_body(cg, location());
 
@@ -357,8 +1085,42 @@ Value OptionDecl::emit(CodeGen& cg, const Def* init) const {
     }
 }
 
+/// Strings at least this long are emitted as blob - thorin still folds shorter ones and @c pe_info prints them.
+static const size_t min_blob_size = 256;
+
+/// The blob holding @p expr if it is a long string literal or an @c include_bytes expression, null otherwise - see @c CodeGen::blob.
+static const Def* emit_blob(CodeGen& cg, const Expr* expr, bool is_mut) {
+    if (auto str = expr->isa<StrExpr>()) {
+        if (str->values().size() >= min_blob_size)
+            return cg.blob(std::string(str->values().begin(), str->values().end()), cg.convert(str->type()), is_mut, str->location());
+    } else if (auto include = expr->isa<IncludeBytesExpr>()) {
+        return cg.blob(include->bytes(), cg.convert(include->type()), is_mut, include->location());
+    }
+    return nullptr;
+}
+
 Value StaticItem::emit(CodeGen& cg, const Def* init) const {
     assert(!init);
+    THORIN_PUSH(cg.cur_fn, nullptr);
+    if (auto blob = this->init() ? emit_blob(cg, this->init(), is_mut()) : nullptr)
+        return Value::create_ptr(cg, blob);
+    if (auto repeated = this->init() ? this->init()->isa<RepeatedDefiniteArrayExpr>() : nullptr) {
+        if (RepeatedDefiniteArrayExpr::is_compact(cg.count(repeated))) {
+            auto value = cg.remit(repeated->value());
+            const Def* compact;
+            if (is_soa(repeated->type())) {
+                auto struct_type = repeated->value()->type();
+                Array<const Def*> columns(struct_type->num_ops());
+                for (size_t i = 0, e = columns.size(); i != e; ++i)
+                    columns[i] = cg.compact_array(cg.extract_field(value, struct_type, i, location()), cg.count(repeated), location());
+                compact = cg.world().tuple(columns, location());
+            } else {
+                compact = cg.compact_array(value, cg.count(repeated), location());
+            }
+            auto global = cg.world().global(compact, is_mut(), debug());
+            return Value::create_ptr(cg, cg.world().bitcast(cg.world().ptr_type(cg.convert(type())), global, location()));
+        }
+    }
     init = !this->init() ? cg.world().bottom(cg.convert(type()), location()) : cg.remit(this->init());
     if (!is_mut())
         return Value::create_val(cg, init);
@@ -412,6 +1174,12 @@ const Def* CharExpr::remit(CodeGen& cg) const {
 }
 
 const Def* StrExpr::remit(CodeGen& cg) const {
+    // a blob can only be loaded within a function
+    if (cg.cur_fn && cg.is_reachable()) {
+        if (auto blob = emit_blob(cg, this, false))
+            return cg.load(blob, location());
+    }
+
     Array<const Def*> args(values_.size());
     for (size_t i = 0, e = args.size(); i != e; ++i)
         args[i] = cg.world().literal_pu8(values_[i], location());
@@ -419,10 +1187,43 @@ const Def* StrExpr::remit(CodeGen& cg) const {
     return cg.world().definite_array(args, location());
 }
 
+const Def* IncludeBytesExpr::remit(CodeGen& cg) const {
+    if (cg.cur_fn && cg.is_reachable())
+        return cg.load(emit_blob(cg, this, false), location());
+
+    // one literal per element within the initializer of a static
+    auto elem_type = type()->as<DefiniteArrayType>()->elem_type()->as<PrimType>();
+    auto tag = elem_type->primtype_tag();
+    auto size = num_bytes(tag);
+    Array<const Def*> args(bytes().size() / size);
+    for (size_t i = 0, e = args.size(); i != e; ++i) {
+        auto p = bytes().data() + i * size;
+        switch (tag) {
+#define IMPALA_LIT(itype, atype) \
+            case PrimType_##itype: { \
+                thorin::atype val; \
+                std::memcpy(&val, p, sizeof(val)); \
+                args[i] = cg.world().literal_##atype(val, location()); \
+                break; \
+            }
+#include "impala/tokenlist.h"
+            default: THORIN_UNREACHABLE;
+        }
+    }
+    return cg.world().definite_array(cg.convert(elem_type), args, location());
+}
+
 const Def* CastExpr::remit(CodeGen& cg) const {
     auto def = cg.remit(src());
     auto thorin_type = cg.convert(type());
-    return cg.world().convert(thorin_type, def, location());
+    auto result = cg.world().convert(thorin_type, def, location());
+    // casting to a more aligned pointer is a promise of the programmer
+    if (auto ptr_type = type()->isa<PtrType>()) {
+        auto src_ptr_type = src()->type()->isa<PtrType>();
+        if (!src_ptr_type || src_ptr_type->align() < ptr_type->align())
+            cg.assume_aligned(result, ptr_type, location());
+    }
+    return result;
 }
 
 Value RValueExpr::lemit(CodeGen& cg) const {
@@ -431,8 +1232,16 @@ Value RValueExpr::lemit(CodeGen& cg) const {
 }
 
 const Def* RValueExpr::remit(CodeGen& cg) const {
-    if (src()->type()->isa<RefType>())
-        return cg.lemit(this).load(location());
+    if (src()->type()->isa<RefType>()) {
+        if (auto map = CodeGen::soa_elem(src())) {
+            auto fields = cg.soa_fields(map);
+            Array<const Def*> defs(fields.size());
+            for (size_t i = 0, e = defs.size(); i != e; ++i)
+                defs[i] = fields[i].load(location());
+            return cg.struct_value(type(), defs, location());
+        }
+        return cg.load_lvalue(src(), cg.lemit(src()), location());
+    }
     return cg.remit(src());
 }
 
@@ -445,10 +1254,10 @@ const Def* PrefixExpr::remit(CodeGen& cg) const {
         case INC:
         case DEC: {
             auto var = cg.lemit(rhs());
-            const Def* def = var.load(location());
+            const Def* def = cg.load_lvalue(rhs(), var, location());
             const Def* one = cg.world().one(def->type(), location());
             const Def* ndef = cg.world().arithop(Token::to_arithop((TokenTag) tag()), def, one, location());
-            var.store(ndef, location());
+            cg.store_lvalue(rhs(), var, ndef, location());
             return ndef;
         }
         case ADD: return cg.remit(rhs());
@@ -467,9 +1276,13 @@ const Def* PrefixExpr::remit(CodeGen& cg) const {
                 return var.def();
             }
 
+            // the address of a long string literal or of include_bytes is the blob itself
+            if (auto blob = emit_blob(cg, rhs(), false))
+                return blob;
+
             auto def = cg.remit(rhs());
             if (is_const(def))
-                return cg.world().global(def, /*mutable*/ false, location());
+                return cg.const_global(def, location());
 
             auto slot = cg.world().slot(cg.convert(rhs()->type()), cg.frame(), location());
             cg.store(slot, def, location());
@@ -534,6 +1347,92 @@ void InfixExpr::emit_branch(CodeGen& cg, JumpTarget& t, JumpTarget& f) const {
     }
 }
 
+/// Size of the primitive @p type in bits.
+static unsigned num_bits(const Type* type) {
+    switch (type->as<PrimType>()->primtype_tag()) {
+        case PrimType_bool:                                      return  1;
+        case PrimType_i8:  case PrimType_u8:                     return  8;
+        case PrimType_i16: case PrimType_u16: case PrimType_f16: return 16;
+        case PrimType_i32: case PrimType_u32: case PrimType_f32: return 32;
+        default:                                                 return 64;
+    }
+}
+
+/// Element type of the simd @p type or @p type itself.
+static const Type* scalar_type(const Type* type) {
+    auto simd_type = type->isa<SimdType>();
+    return simd_type ? simd_type->elem_type() : type;
+}
+
+/// Mangled name of @p type as used by overloaded LLVM intrinsics, e.g. @c v8f32 for <tt>simd[f32 * 8]</tt>.
+static std::string llvm_mangle(const Type* type) {
+    if (auto simd_type = type->isa<SimdType>())
+        return "v" + std::to_string(simd_type->dim()) + llvm_mangle(simd_type->elem_type());
+    if (auto ptr_type = type->isa<PtrType>())
+        return "p" + std::to_string(ptr_type->addr_space()) + llvm_mangle(ptr_type->pointee());
+    return (is_float(type) ? "f" : "i") + std::to_string(num_bits(type));
+}
+
+/// @p FastMath flags which only LLVM can apply - to the instruction of each operation.
+static const unsigned FastMath_llvm = FastMath_reassoc | FastMath_nnan | FastMath_ninf;
+
+/// May additions and subtractions of @p type be fused with a multiplication via @c llvm.fmuladd?
+/// With any of @p FastMath_llvm the operations carry LLVM's @c contract flag instead.
+static bool is_contractible(CodeGen& cg, const Type* type) {
+    return (cg.fast_math & FastMath_contract) && !(cg.fast_math & FastMath_llvm) && is_float(scalar_type(type));
+}
+
+/// @p expr if it is a multiplication.
+static const InfixExpr* mul_expr(const Expr* expr) {
+    auto infix = expr->isa<InfixExpr>();
+    return infix && infix->tag() == InfixExpr::MUL ? infix : nullptr;
+}
+
+/// <tt>a * b + c</tt> via @c llvm.fmuladd which LLVM fuses to a single instruction where the target has one.
+static const Def* fmuladd(CodeGen& cg, const Type* type, const Def* a, const Def* b, const Def* c, Location location) {
+    auto name = "llvm.fmuladd." + llvm_mangle(type);
+    auto t = cg.convert(type);
+    auto cont = cg.world().continuation(cg.world().fn_type({
+        cg.world().mem_type(), t, t, t, cg.world().fn_type({ cg.world().mem_type(), t }) }), {location, name});
+    cont->cc() = thorin::CC::Device;
+    auto ret = cg.call(cont, {cg.get_mem(), a, b, c}, t, thorin::Debug(location, name) + "_cont");
+    cg.set_mem(cg.cur_bb->param(0));
+    return ret;
+}
+
+/**
+ * Emits @p op of @p ldef and @p rdef; the division by a float literal becomes the multiplication with its folded reciprocal under @c arcp.
+ * Float arithmetic under any of @p FastMath_llvm is emitted as the pseudo function <tt>impala.fmath.OP.FLAGS.TYPE</tt>.
+ */
+static const Def* emit_binop(CodeGen& cg, TokenTag op, const Def* ldef, const Def* rdef, const Expr* rhs, Location location) {
+    auto type = cg.instantiate(unpack_ref_type(rhs->type()));
+    if ((cg.fast_math & FastMath_llvm) && is_float(scalar_type(type)) && cg.is_reachable()) {
+        const char* name = nullptr;
+        switch (op) {
+            case Token::ADD: name = "fadd"; break;
+            case Token::SUB: name = "fsub"; break;
+            case Token::MUL: name = "fmul"; break;
+            case Token::DIV: name = "fdiv"; break;
+            case Token::REM: name = "frem"; break;
+            default: break;
+        }
+        if (name) {
+            std::string flags;
+            for (auto flag : {std::make_pair(FastMath_reassoc, "reassoc"), std::make_pair(FastMath_contract, "contract"),
+                              std::make_pair(FastMath_nnan, "nnan"), std::make_pair(FastMath_ninf, "ninf"), std::make_pair(FastMath_arcp, "arcp")}) {
+                if (cg.fast_math & flag.first)
+                    flags += std::string(".") + flag.second;
+            }
+            return cg.call_pseudo(std::string("impala.fmath.") + name + flags + "." + llvm_mangle(type), {ldef, rdef}, ldef->type(), location);
+        }
+    }
+    if (op == Token::DIV && (cg.fast_math & FastMath_arcp) && rhs->isa<LiteralExpr>() && is_float(rhs->type())) {
+        auto one = cg.world().one(rdef->type(), location);
+        return cg.world().arithop_mul(ldef, cg.world().arithop_div(one, rdef, location), location);
+    }
+    return cg.world().binop(Token::to_binop(op), ldef, rdef, location);
+}
+
 const Def* InfixExpr::remit(CodeGen& cg) const {
     switch (tag()) {
         case ANDAND: {
@@ -557,30 +1456,75 @@ const Def* InfixExpr::remit(CodeGen& cg) const {
         default:
             const TokenTag op = (TokenTag) tag();
 
+            if (op == Token::ASGN) {
+                if (auto map = CodeGen::soa_elem(lhs())) {
+                    auto fields = cg.soa_fields(map);
+                    const Def* rdef = cg.remit(rhs());
+                    for (size_t i = 0, e = fields.size(); i != e; ++i)
+                        fields[i].store(cg.extract_field(rdef, rhs()->type(), i, location()), location());
+                    return cg.world().tuple({}, location());
+                }
+            }
+
             if (Token::is_assign(op)) {
                 Value lvar = cg.lemit(lhs());
+                auto type = cg.instantiate(unpack_ref_type(lhs()->type()));
+
+                // x += a*b is fmuladd(a, b, x) and x -= a*b is fmuladd(-a, b, x)
+                auto mul = mul_expr(rhs());
+                if ((op == Token::ADD_ASGN || op == Token::SUB_ASGN) && mul && is_contractible(cg, type)) {
+                    const Def* a = cg.remit(mul->lhs());
+                    const Def* b = cg.remit(mul->rhs());
+                    if (op == Token::SUB_ASGN)
+                        a = cg.world().arithop_minus(a, location());
+                    cg.store_lvalue(lhs(), lvar, fmuladd(cg, type, a, b, cg.load_lvalue(lhs(), lvar, location()), location()), location());
+                    return cg.world().tuple({}, location());
+                }
+
                 const Def* rdef = cg.remit(rhs());
 
                 if (op != Token::ASGN) {
                     TokenTag sop = Token::separate_assign(op);
-                    rdef = cg.world().binop(Token::to_binop(sop), lvar.load(location()), rdef, location());
+                    rdef = emit_binop(cg, sop, cg.load_lvalue(lhs(), lvar, location()), rdef, rhs(), location());
                 }
 
-                lvar.store(rdef, location());
+                cg.store_lvalue(lhs(), lvar, rdef, location());
                 return cg.world().tuple({}, location());
             }
 
+            auto type = cg.instantiate(this->type());
+            if ((op == Token::ADD || op == Token::SUB) && is_contractible(cg, type)) {
+                // a*b ± c is fmuladd(a, b, ±c)
+                if (auto mul = mul_expr(lhs())) {
+                    const Def* a = cg.remit(mul->lhs());
+                    const Def* b = cg.remit(mul->rhs());
+                    const Def* c = cg.remit(rhs());
+                    if (op == Token::SUB)
+                        c = cg.world().arithop_minus(c, location());
+                    return fmuladd(cg, type, a, b, c, location());
+                }
+                // c ± a*b is fmuladd(±a, b, c)
+                if (auto mul = mul_expr(rhs())) {
+                    const Def* c = cg.remit(lhs());
+                    const Def* a = cg.remit(mul->lhs());
+                    const Def* b = cg.remit(mul->rhs());
+                    if (op == Token::SUB)
+                        a = cg.world().arithop_minus(a, location());
+                    return fmuladd(cg, type, a, b, c, location());
+                }
+            }
+
             const Def* ldef = cg.remit(lhs());
             const Def* rdef = cg.remit(rhs());
-            return cg.world().binop(Token::to_binop(op), ldef, rdef, location());
+            return emit_binop(cg, op, ldef, rdef, rhs(), location());
     }
 }
 
 const Def* PostfixExpr::remit(CodeGen& cg) const {
     Value var = cg.lemit(lhs());
-    const Def* def = var.load(location());
+    const Def* def = cg.load_lvalue(lhs(), var, location());
     const Def* one = cg.world().one(def->type(), location());
-    var.store(cg.world().arithop(Token::to_arithop((TokenTag) tag()), def, one, location()), location());
+    cg.store_lvalue(lhs(), var, cg.world().arithop(Token::to_arithop((TokenTag) tag()), def, one, location()), location());
     return def;
 }
 
@@ -588,12 +1532,19 @@ const Def* DefiniteArrayExpr::remit(CodeGen& cg) const {
     Array<const Def*> thorin_args(num_args());
     for (size_t i = 0, e = num_args(); i != e; ++i)
         thorin_args[i] = cg.remit(arg(i));
+    if (is_soa(type()))
+        return cg.soa_array(type(), thorin_args, location());
     return cg.world().definite_array(cg.convert(type())->as<thorin::DefiniteArrayType>()->elem_type(), thorin_args, location());
 }
 
 const Def* RepeatedDefiniteArrayExpr::remit(CodeGen& cg) const {
-    Array<const Def*> args(count());
-    std::fill_n(args.begin(), count(), cg.remit(value()));
+    // statics are no part of the function which refers to them first - they need a constant
+    if (cg.cur_fn && is_compact(cg.count(this)))
+        return cg.load(cg.filled_slot(this, {location(), "repeated"}), location());
+    Array<const Def*> args(cg.count(this));
+    std::fill_n(args.begin(), args.size(), cg.remit(value()));
+    if (is_soa(type()))
+        return cg.soa_array(type(), args, location());
     return cg.world().definite_array(args, location());
 }
 
@@ -620,17 +1571,125 @@ const Def* StructExpr::remit(CodeGen& cg) const {
     Array<const Def*> defs(num_elems());
     for (const auto& elem : elems())
         defs[elem->field_decl()->index()] = cg.remit(elem->expr());
-    return cg.world().struct_agg(cg.convert(type())->as<thorin::StructType>(), defs, location());
+    return cg.struct_value(type(), defs, location());
 }
 
 Value TypeAppExpr::lemit(CodeGen&) const { THORIN_UNREACHABLE; }
 
-const Def* TypeAppExpr::remit(CodeGen& /*cg*/) const {
+const Def* TypeAppExpr::remit(CodeGen& cg) const {
+    if (auto path = lhs()->skip_rvalue()->isa<PathExpr>()) {
+        if (auto fn_decl = path->value_decl() ? path->value_decl()->isa<FnDecl>() : nullptr) {
+            if (fn_decl->body())
+                return cg.instance(fn_decl, type_args(), location());
+        }
+    }
     assert(false && "TODO");
     THORIN_UNREACHABLE;
 }
 
+/// Combines the upper half of the lanes of @p v with the lower half until a single lane is left.
+static const Def* reduce(CodeGen& cg, Intrinsic intrinsic, const Def* v, uint64_t dim, Location location) {
+    auto combine = [&] (const Def* a, const Def* b) {
+        switch (intrinsic) {
+            case Intrinsic_reduce_add: return cg.world().arithop_add(a, b, location);
+            case Intrinsic_reduce_mul: return cg.world().arithop_mul(a, b, location);
+            case Intrinsic_reduce_min: return cg.world().select(cg.world().cmp_lt(a, b, location), a, b, location);
+            default:                   return cg.world().select(cg.world().cmp_gt(a, b, location), a, b, location);
+        }
+    };
+    auto lanes = [&] (const Def* v, uint64_t begin, uint64_t end) {
+        if (end - begin == 1)
+            return cg.world().extract(v, uint32_t(begin), location);
+        Array<const Def*> elems(end - begin);
+        for (uint64_t i = begin; i != end; ++i)
+            elems[i - begin] = cg.world().extract(v, uint32_t(i), location);
+        return cg.world().vector(elems, location);
+    };
+
+    while (dim > 1) {
+        auto half = dim / 2;
+        auto combined = combine(lanes(v, 0, half), lanes(v, half, 2 * half));
+        if (dim % 2 == 0) {
+            v = combined;
+        } else {
+            // carry the odd lane over to the next round
+            Array<const Def*> elems(half + 1);
+            for (uint64_t i = 0; i != half; ++i)
+                elems[i] = half == 1 ? combined : cg.world().extract(combined, uint32_t(i), location);
+            elems.back() = cg.world().extract(v, uint32_t(dim - 1), location);
+            v = cg.world().vector(elems, location);
+        }
+        dim = half + dim % 2;
+    }
+    return v;
+}
+
+/// High half of the full product of the integers or integer vectors @p a and @p b of @p type.
+static const Def* mulhi(CodeGen& cg, const Type* type, const Def* a, const Def* b, Location location) {
+    auto thorin_type = a->type()->as<thorin::PrimType>();
+    auto dim = thorin_type->length();
+    // @p value as constant of the scalar type @p tag - splatted to all lanes
+    auto constant = [&] (thorin::PrimTypeTag tag, uint64_t value) -> const Def* {
+        auto literal = cg.world().cast(cg.world().type(tag), cg.world().literal_pu64(value, location), location);
+        if (dim == 1)
+            return literal;
+        Array<const Def*> lanes(dim);
+        std::fill(lanes.begin(), lanes.end(), literal);
+        return cg.world().vector(lanes, location);
+    };
+
+    auto bits = num_bits(scalar_type(type));
+    if (bits < 64) {
+        // LLVM selects the high-half multiplication of the target for the widened product
+        thorin::PrimTypeTag wide_tag;
+        switch (thorin_type->primtype_tag()) {
+            case thorin::PrimType_qs8:  wide_tag = thorin::PrimType_qs16; break;
+            case thorin::PrimType_qs16: wide_tag = thorin::PrimType_qs32; break;
+            case thorin::PrimType_qs32: wide_tag = thorin::PrimType_qs64; break;
+            case thorin::PrimType_pu8:  wide_tag = thorin::PrimType_pu16; break;
+            case thorin::PrimType_pu16: wide_tag = thorin::PrimType_pu32; break;
+            case thorin::PrimType_pu32: wide_tag = thorin::PrimType_pu64; break;
+            default: THORIN_UNREACHABLE;
+        }
+        auto wide_type = cg.world().type(wide_tag, dim);
+        auto product = cg.world().arithop_mul(cg.world().cast(wide_type, a, location), cg.world().cast(wide_type, b, location), location);
+        return cg.world().cast(thorin_type, cg.world().arithop_shr(product, constant(wide_tag, bits), location), location);
+    }
+
+    // there is no 128-bit type: combine the products of the 32-bit halves of the unsigned operands
+    auto u64_type = cg.world().type(thorin::PrimType_pu64, dim);
+    auto ua = cg.world().bitcast(u64_type, a, location);
+    auto ub = cg.world().bitcast(u64_type, b, location);
+    auto lo = [&] (const Def* x) { return cg.world().arithop_and(x, constant(thorin::PrimType_pu64, 0xffffffff), location); };
+    auto hi = [&] (const Def* x) { return cg.world().arithop_shr(x, constant(thorin::PrimType_pu64, 32), location); };
+    auto mul = [&] (const Def* x, const Def* y) { return cg.world().arithop_mul(x, y, location); };
+    auto add = [&] (const Def* x, const Def* y) { return cg.world().arithop_add(x, y, location); };
+    auto ll = mul(lo(ua), lo(ub));
+    auto lh = mul(lo(ua), hi(ub));
+    auto hl = mul(hi(ua), lo(ub));
+    auto hh = mul(hi(ua), hi(ub));
+    auto carry = hi(add(add(hi(ll), lo(lh)), lo(hl)));
+    auto result = add(add(add(hh, hi(lh)), hi(hl)), carry);
+
+    if (is_signed(scalar_type(type))) {
+        // a negative operand adds 2^64 times the other one to the unsigned product
+        auto sign = [&] (const Def* x) {
+            return cg.world().bitcast(u64_type, cg.world().arithop_shr(x, constant(thorin::PrimType_qs64, 63), location), location);
+        };
+        result = cg.world().arithop_sub(result, cg.world().arithop_and(sign(a), ub, location), location);
+        result = cg.world().arithop_sub(result, cg.world().arithop_and(sign(b), ua, location), location);
+    }
+    return cg.world().bitcast(thorin_type, result, location);
+}
+
 Value MapExpr::lemit(CodeGen& cg) const {
+    if (unpack_ref_type(lhs()->type())->isa<SliceType>()) {
+        auto slice = cg.remit(lhs());
+        auto index = cg.world().cast(cg.world().type_qs64(), cg.remit(arg(0)), location());
+        cg.check_bounds(cg.cmp_bounds(index, cg.extract(slice, 1, location()), false, location()), location());
+        return Value::create_ptr(cg, cg.world().lea(cg.extract(slice, 0, location()), index, location()));
+    }
+
     auto agg = cg.lemit(lhs());
     return Value::create_agg(agg, cg.remit(arg(0)));
 }
@@ -640,70 +1699,204 @@ const Def* MapExpr::remit(CodeGen& cg) const {
 
     if (auto fn_type = ltype->isa<FnType>()) {
         const Def* dst = nullptr;
+        size_t num_call_args = num_args();
 
         // Handle primops here
-        if (auto type_expr = lhs()->isa<TypeAppExpr>()) { // Bitcast, sizeof and select are all polymorphic
-            auto callee = type_expr->lhs()->skip_rvalue();
-            if (auto path = callee->isa<PathExpr>()) {
-                if (auto fn_decl = path->value_decl()->isa<FnDecl>()) {
-                    if (fn_decl->is_extern() && fn_decl->abi() == "\"thorin\"") {
-                        auto name = fn_decl->fn_symbol().remove_quotation();
-                        if (name == "bitcast") {
-                            return cg.world().bitcast(cg.convert(type_expr->type_arg(0)), cg.remit(arg(0)), location());
-                        } else if (name == "select") {
-                            return cg.world().select(cg.remit(arg(0)), cg.remit(arg(1)), cg.remit(arg(2)), location());
-                        } else if (name == "insert") {
-                            return cg.world().insert(cg.remit(arg(0)), cg.remit(arg(1)), cg.remit(arg(2)), location());
-                        } else if (name == "sizeof") {
-                            return cg.world().size_of(cg.convert(type_expr->type_arg(0)), location());
-                        } else if (name == "undef") {
-                            return cg.world().bottom(cg.convert(type_expr->type_arg(0)), location());
-                        } else if (name == "reserve_shared") {
-                            auto ptr_type = cg.convert(type());
-                            auto fn_type = cg.world().fn_type({
-                                cg.world().mem_type(), cg.world().type_qs32(),
-                                cg.world().fn_type({ cg.world().mem_type(), ptr_type }) });
-                            auto cont = cg.world().continuation(fn_type, {location(), "reserve_shared"});
-                            cont->set_intrinsic();
-                            dst = cont;
-                        } else if (name == "atomic") {
-                            auto poly_type = cg.convert(type());
-                            auto ptr_type = cg.convert(arg(1)->type());
-                            auto fn_type = cg.world().fn_type({
-                                cg.world().mem_type(), cg.world().type_pu32(), ptr_type, poly_type,
-                                cg.world().fn_type({ cg.world().mem_type(), poly_type }) });
-                            auto cont = cg.world().continuation(fn_type, {location(), "atomic"});
-                            cont->set_intrinsic();
-                            dst = cont;
-                        } else if (name == "cmpxchg") {
-                            auto ptr_type = cg.convert(arg(0)->type());
-                            auto poly_type = ptr_type->as<thorin::PtrType>()->pointee();
-                            auto fn_type = cg.world().fn_type({
-                                cg.world().mem_type(), ptr_type, poly_type, poly_type,
-                                cg.world().fn_type({ cg.world().mem_type(), poly_type, cg.world().type_bool() })
-                            });
-                            auto cont = cg.world().continuation(fn_type, {location(), "cmpxchg"});
-                            cont->set_intrinsic();
-                            dst = cont;
-                        } else if (name == "pe_info") {
-                            auto poly_type = cg.convert(arg(1)->type());
-                            auto string_type = cg.world().ptr_type(cg.world().indefinite_array_type(cg.world().type_pu8()));
-                            auto fn_type = cg.world().fn_type({
-                                cg.world().mem_type(), string_type, poly_type,
-                                cg.world().fn_type({ cg.world().mem_type() }) });
-                            auto cont = cg.world().continuation(fn_type, {location(), "pe_info"});
-                            cont->set_intrinsic();
-                            dst = cont;
-                        } else if (name == "pe_known") {
-                            auto poly_type = cg.convert(arg(0)->type());
-                            auto fn_type = cg.world().fn_type({
-                                cg.world().mem_type(), poly_type,
-                                cg.world().fn_type({ cg.world().mem_type(), cg.world().type_bool() }) });
-                            auto cont = cg.world().continuation(fn_type, {location(), "pe_known"});
-                            cont->set_intrinsic();
-                            dst = cont;
+        auto type_expr = lhs()->isa<TypeAppExpr>();
+        auto callee = type_expr ? type_expr->lhs()->skip_rvalue() : lhs()->skip_rvalue();
+        if (auto path = callee->isa<PathExpr>()) {
+            if (auto fn_decl = path->value_decl()->isa<FnDecl>()) {
+                auto thorin_intrinsic = [&] (const thorin::FnType* fn_type, thorin::Debug dbg) {
+                    auto cont = cg.world().continuation(fn_type, dbg);
+                    cont->set_intrinsic();
+                    return cont;
+                };
+                auto intrinsic = [&] (const thorin::FnType* fn_type) {
+                    return thorin_intrinsic(fn_type, {location(), fn_decl->fn_symbol().remove_quotation()});
+                };
+                // atomics with orderings are pseudo functions named after the LLVM instruction, its orderings and types - see finish_llvm
+                auto literal = [&] (size_t i) { return std::to_string(arg(i)->as<LiteralExpr>()->get_u64()); };
+                auto ptr_mangle = [&] (size_t i) { return llvm_mangle(cg.instantiate(unpack_ref_type(arg(i)->type()))); };
+                // calls the LLVM intrinsic @p name and returns like the declaration of the thorin intrinsic
+                auto call_llvm = [&] (const std::string& name, Defs args) {
+                    Array<const thorin::Type*> types(args.size() + 2);
+                    types.front() = cg.world().mem_type();
+                    for (size_t i = 0, e = args.size(); i != e; ++i)
+                        types[i + 1] = args[i]->type();
+                    types.back() = cg.convert(fn_type)->as<thorin::FnType>()->ops().back();
+                    auto cont = cg.world().continuation(cg.world().fn_type(types), {location(), name});
+                    cont->cc() = thorin::CC::Device;
+
+                    Array<const Def*> defs(args.size() + 1);
+                    defs.front() = cg.get_mem();
+                    std::copy(args.begin(), args.end(), defs.begin() + 1);
+                    auto ret = cg.call(cont, defs, cg.convert(fn_type->return_type()), thorin::Debug(location(), name) + "_cont");
+                    cg.set_mem(cg.cur_bb->param(0));
+                    return ret;
+                };
+
+                switch (fn_decl->intrinsic()) {
+                    case Intrinsic_bitcast:
+                        return cg.world().bitcast(cg.convert(type_expr->type_arg(0)), cg.remit(arg(0)), location());
+                    case Intrinsic_select:
+                        return cg.world().select(cg.remit(arg(0)), cg.remit(arg(1)), cg.remit(arg(2)), location());
+                    case Intrinsic_insert:
+                        return cg.world().insert(cg.remit(arg(0)), cg.remit(arg(1)), cg.remit(arg(2)), location());
+                    case Intrinsic_sizeof:
+                        return cg.world().size_of(cg.convert(type_expr->type_arg(0)), location());
+                    case Intrinsic_undef:
+                        return cg.world().bottom(cg.convert(type_expr->type_arg(0)), location());
+                    case Intrinsic_reserve_shared: {
+                        auto ptr_type = cg.convert(type());
+                        dst = intrinsic(cg.world().fn_type({
+                            cg.world().mem_type(), cg.world().type_qs32(),
+                            cg.world().fn_type({ cg.world().mem_type(), ptr_type }) }));
+                        break;
+                    }
+                    // thorin's atomics are sequentially consistent - they remain for calls without orderings
+                    case Intrinsic_atomic: {
+                        auto poly_type = cg.convert(type());
+                        if (num_args() == 4) {
+                            auto ptr = cg.remit(arg(1));
+                            auto name = "impala.atomicrmw." + literal(0) + "." + literal(3) + "." + ptr_mangle(1);
+                            return cg.call_pseudo(name, {ptr, cg.remit(arg(2))}, poly_type, location());
                         }
+                        auto ptr_type = cg.convert(arg(1)->type());
+                        dst = intrinsic(cg.world().fn_type({
+                            cg.world().mem_type(), cg.world().type_pu32(), ptr_type, poly_type,
+                            cg.world().fn_type({ cg.world().mem_type(), poly_type }) }));
+                        break;
+                    }
+                    case Intrinsic_cmpxchg:
+                    case Intrinsic_cmpxchg_weak: {
+                        bool weak = fn_decl->intrinsic() == Intrinsic_cmpxchg_weak;
+                        if (num_args() == 5 || weak) {
+                            auto orderings = num_args() == 5 ? literal(3) + "." + literal(4) : std::string("7.7");
+                            auto name = "impala.cmpxchg." + orderings + (weak ? ".weak." : ".strong.") + ptr_mangle(0);
+                            auto ptr = cg.remit(arg(0));
+                            auto cmp = cg.remit(arg(1));
+                            return cg.call_pseudo(name, {ptr, cmp, cg.remit(arg(2))}, cg.convert(type()), location());
+                        }
+                        auto ptr_type = cg.convert(arg(0)->type());
+                        auto poly_type = ptr_type->as<thorin::PtrType>()->pointee();
+                        dst = thorin_intrinsic(cg.world().fn_type({
+                            cg.world().mem_type(), ptr_type, poly_type, poly_type,
+                            cg.world().fn_type({ cg.world().mem_type(), poly_type, cg.world().type_bool() }) }), {location(), "cmpxchg"});
+                        break;
+                    }
+                    case Intrinsic_atomic_load:
+                        return cg.call_pseudo("impala.load." + literal(1) + "." + ptr_mangle(0), {cg.remit(arg(0))}, cg.convert(type()), location());
+                    case Intrinsic_atomic_store: {
+                        auto ptr = cg.remit(arg(0));
+                        return cg.call_pseudo("impala.store." + literal(2) + "." + ptr_mangle(0), {ptr, cg.remit(arg(1))}, nullptr, location());
+                    }
+                    case Intrinsic_fence:
+                        return cg.call_pseudo("impala.fence." + literal(0), {}, nullptr, location());
+                    // a store with !nontemporal metadata - see finish_llvm
+                    case Intrinsic_store_nontemporal: {
+                        auto ptr = cg.remit(arg(0));
+                        return cg.call_pseudo("impala.store.nontemporal." + ptr_mangle(0), {ptr, cg.remit(arg(1))}, nullptr, location());
+                    }
+                    case Intrinsic_pe_info: {
+                        auto poly_type = cg.convert(arg(1)->type());
+                        auto string_type = cg.world().ptr_type(cg.world().indefinite_array_type(cg.world().type_pu8()));
+                        dst = intrinsic(cg.world().fn_type({
+                            cg.world().mem_type(), string_type, poly_type,
+                            cg.world().fn_type({ cg.world().mem_type() }) }));
+                        break;
+                    }
+                    case Intrinsic_pe_known: {
+                        auto poly_type = cg.convert(arg(0)->type());
+                        dst = intrinsic(cg.world().fn_type({
+                            cg.world().mem_type(), poly_type,
+                            cg.world().fn_type({ cg.world().mem_type(), cg.world().type_bool() }) }));
+                        break;
+                    }
+                    case Intrinsic_shuffle: {
+                        auto a = cg.remit(arg(0));
+                        auto b = cg.remit(arg(1));
+                        auto dim = cg.instantiate(arg(0)->type())->as<SimdType>()->dim();
+                        auto mask = arg(2)->as<SimdExpr>();
+                        Array<const Def*> lanes(mask->num_args());
+                        for (size_t i = 0, e = lanes.size(); i != e; ++i) {
+                            auto index = mask->arg(i)->as<LiteralExpr>()->get_u64();
+                            lanes[i] = index < dim ? cg.world().extract(a, uint32_t(index), location())
+                                                   : cg.world().extract(b, uint32_t(index - dim), location());
+                        }
+                        return cg.world().vector(lanes, location());
+                    }
+                    case Intrinsic_reduce_add:
+                    case Intrinsic_reduce_mul:
+                    case Intrinsic_reduce_min:
+                    case Intrinsic_reduce_max:
+                        return reduce(cg, fn_decl->intrinsic(), cg.remit(arg(0)), cg.instantiate(arg(0)->type())->as<SimdType>()->dim(), location());
+                    case Intrinsic_gather:
+                    case Intrinsic_scatter: {
+                        auto ptr = cg.remit(arg(0));
+                        auto index = cg.remit(arg(1));
+                        auto dim = cg.instantiate(arg(1)->type())->as<SimdType>()->dim();
+                        auto ptr_type = cg.instantiate(arg(0)->type())->as<PtrType>();
+                        auto elem_type = ptr_type->pointee()->as<ArrayType>()->elem_type();
+                        Array<const Def*> ptrs(dim), mask(dim);
+                        for (size_t i = 0; i != dim; ++i) {
+                            ptrs[i] = cg.world().lea(ptr, cg.world().extract(index, uint32_t(i), location()), location());
+                            mask[i] = cg.world().literal_bool(true, location());
+                        }
+                        auto ptrs_vector = cg.world().vector(ptrs, location());
+                        auto align = cg.world().literal_qs32(std::max(num_bits(elem_type) / 8, 1u), location());
+                        auto suffix = "v" + std::to_string(dim) + llvm_mangle(elem_type) + ".v" + std::to_string(dim)
+                                    + "p" + std::to_string(ptr_type->addr_space()) + llvm_mangle(elem_type);
+                        if (fn_decl->intrinsic() == Intrinsic_gather)
+                            return call_llvm("llvm.masked.gather." + suffix,
+                                             {ptrs_vector, align, cg.world().vector(mask, location()), cg.world().bottom(cg.convert(type()), location())});
+                        return call_llvm("llvm.masked.scatter." + suffix,
+                                         {cg.remit(arg(2)), ptrs_vector, align, cg.world().vector(mask, location())});
+                    }
+                    case Intrinsic_masked_load:
+                    case Intrinsic_masked_store: {
+                        auto ptr = cg.remit(arg(0));
+                        auto mask = cg.remit(arg(1));
+                        auto values = cg.remit(arg(2));
+                        auto simd_type = cg.instantiate(arg(2)->type())->as<SimdType>();
+                        auto ptr_type = cg.instantiate(arg(0)->type())->as<PtrType>();
+                        auto simd_ptr = cg.world().bitcast(cg.world().ptr_type(cg.convert(simd_type), 1, -1, thorin::AddrSpace(ptr_type->addr_space())), ptr, location());
+                        auto align = cg.world().literal_qs32(std::max({num_bits(simd_type->elem_type()) / 8, 1u, unsigned(ptr_type->align())}), location());
+                        auto suffix = llvm_mangle(simd_type) + ".p" + std::to_string(ptr_type->addr_space()) + llvm_mangle(simd_type);
+                        if (fn_decl->intrinsic() == Intrinsic_masked_load)
+                            return call_llvm("llvm.masked.load." + suffix, {simd_ptr, align, mask, values});
+                        return call_llvm("llvm.masked.store." + suffix, {values, simd_ptr, align, mask});
                     }
+                    case Intrinsic_prefetch: {
+                        auto ptr = cg.remit(arg(0));
+                        auto addr_space = arg(0)->type()->as<PtrType>()->addr_space();
+                        auto byte_ptr = cg.world().bitcast(cg.world().ptr_type(cg.world().type_pu8(), 1, -1, thorin::AddrSpace(addr_space)), ptr, location());
+                        auto rw = cg.world().literal_qs32(int32_t(arg(1)->as<LiteralExpr>()->get_u64()), location());
+                        auto locality = cg.world().literal_qs32(int32_t(arg(2)->as<LiteralExpr>()->get_u64()), location());
+                        auto data_cache = cg.world().literal_qs32(1, location());
+                        return call_llvm("llvm.prefetch.p" + std::to_string(addr_space) + "i8", {byte_ptr, rw, locality, data_cache});
+                    }
+                    case Intrinsic_add_sat:
+                    case Intrinsic_sub_sat: {
+                        auto type = cg.instantiate(arg(0)->type());
+                        auto name = std::string(is_signed(scalar_type(type)) ? "llvm.s" : "llvm.u")
+                                  + (fn_decl->intrinsic() == Intrinsic_add_sat ? "add" : "sub") + ".sat." + llvm_mangle(type);
+                        return call_llvm(name, {cg.remit(arg(0)), cg.remit(arg(1))});
+                    }
+                    case Intrinsic_add_overflow:
+                    case Intrinsic_sub_overflow:
+                    case Intrinsic_mul_overflow: {
+                        auto type = cg.instantiate(arg(0)->type());
+                        auto op = fn_decl->intrinsic() == Intrinsic_add_overflow ? "add" : fn_decl->intrinsic() == Intrinsic_sub_overflow ? "sub" : "mul";
+                        auto name = std::string(is_signed(scalar_type(type)) ? "llvm.s" : "llvm.u") + op + ".with.overflow." + llvm_mangle(type);
+                        return call_llvm(name, {cg.remit(arg(0)), cg.remit(arg(1))});
+                    }
+                    case Intrinsic_mulhi: {
+                        auto a = cg.remit(arg(0));
+                        auto b = cg.remit(arg(1));
+                        return mulhi(cg, cg.instantiate(arg(0)->type()), a, b, location());
+                    }
+                    default:
+                        break;
                 }
             }
         }
@@ -712,8 +1905,8 @@ const Def* MapExpr::remit(CodeGen& cg) const {
 
         std::vector<const Def*> defs;
         defs.push_back(nullptr); // reserve for mem but set later - some other args may update the monad
-        for (const auto& arg : args())
-            defs.push_back(cg.remit(arg.get()));
+        for (size_t i = 0; i != num_call_args; ++i)
+            defs.push_back(cg.remit(arg(i)));
         defs.front() = cg.get_mem(); // now get the current memory monad
 
         auto ret_type = num_args() == fn_type->num_params() ? nullptr : cg.convert(fn_type->return_type());
@@ -722,6 +1915,13 @@ const Def* MapExpr::remit(CodeGen& cg) const {
             cg.set_mem(cg.cur_bb->param(0));
 
         return ret;
+    } else if (is_soa(ltype)) {
+        auto array = cg.remit(lhs());
+        auto index = cg.remit(arg(0));
+        Array<const Def*> defs(array->type()->num_ops());
+        for (size_t i = 0, e = defs.size(); i != e; ++i)
+            defs[i] = cg.extract(cg.extract(array, i, location()), index, location());
+        return cg.struct_value(type(), defs, location());
     } else if (ltype->isa<ArrayType>() || ltype->isa<TupleType>() || ltype->isa<SimdType>()) {
         auto index = cg.remit(arg(0));
         return cg.extract(cg.remit(lhs()), index, location());
@@ -730,15 +1930,44 @@ const Def* MapExpr::remit(CodeGen& cg) const {
 }
 
 Value FieldExpr::lemit(CodeGen& cg) const {
-    auto value = cg.lemit(lhs());
-    return Value::create_agg(value, cg.world().literal_qu32(index(), location()));
+    if (auto map = CodeGen::soa_elem(lhs()))
+        return cg.soa_fields(map)[index()];
+    return cg.field_value(cg.lemit(lhs()), unpack_ref_type(lhs()->type()), index(), location());
 }
 
 const Def* FieldExpr::remit(CodeGen& cg) const {
-    return cg.extract(cg.remit(lhs()), index(), location());
+    if (unpack_ref_type(lhs()->type())->isa<SliceType>())
+        return cg.extract(cg.remit(lhs()), 1, location()); // len
+    return cg.extract_field(cg.remit(lhs()), unpack_ref_type(lhs()->type()), index(), location());
+}
+
+const Def* SliceExpr::remit(CodeGen& cg) const {
+    auto lhs = cg.remit(this->lhs());
+    auto begin = cg.world().cast(cg.world().type_qs64(), cg.remit(this->begin()), location());
+    auto end   = cg.world().cast(cg.world().type_qs64(), cg.remit(this->end()),   location());
+
+    // the length of indefinite arrays is unknown - only begin <= end is checked then
+    const Def* ptr = lhs;
+    const Def* len = nullptr;
+    if (unpack_ref_type(this->lhs()->type())->isa<SliceType>()) {
+        ptr = cg.extract(lhs, 0, location());
+        len = cg.extract(lhs, 1, location());
+    } else if (auto array_type = lhs->type()->as<thorin::PtrType>()->pointee()->isa<thorin::DefiniteArrayType>()) {
+        len = cg.world().literal_qs64(array_type->dim(), location());
+    }
+
+    auto cond = cg.cmp_bounds(begin, end, true, location());
+    if (len)
+        cond = cg.world().arithop_and(cond, cg.cmp_bounds(end, len, true, location()), location());
+    cg.check_bounds(cond, location());
+
+    auto slice_type = cg.convert(type())->as<thorin::StructType>();
+    auto first = cg.world().bitcast(slice_type->op(0), cg.world().lea(ptr, begin, location()), location());
+    return cg.world().struct_agg(slice_type, {first, cg.world().arithop_sub(end, begin, location())}, location());
 }
 
 const Def* BlockExpr::remit(CodeGen& cg) const {
+    THORIN_PUSH(cg.fast_math, cg.fast_math | fast_math_flags(this));
     for (const auto& stmt : stmts())
         cg.emit(stmt.get());
     return cg.remit(expr());
@@ -760,67 +1989,424 @@ const Def* IfExpr::remit(CodeGen& cg) const {
     return cg.converge(this, x);
 }
 
-void MatchExpr::emit_jump(CodeGen& cg, JumpTarget& x) const {
-    auto matcher = cg.remit(expr());
-    auto enum_type = expr()->type()->isa<EnumType>();
-    bool is_integer = is_int(expr()->type());
-    bool is_simple = enum_type && enum_type->enum_decl()->is_simple();
-
-    if (is_integer || is_simple) {
-        // integers: match continuation
-        JumpTarget otherwise;
-        size_t num_targets = num_arms();
-        Array<const Def*> defs(num_targets);
-        Array<JumpTarget> targets(num_targets);
-
-        for (size_t i = 0, e = num_targets; i != e; ++i) {
-            // last pattern will always be taken
-            if (!arm(i)->ptrn()->is_refutable() || i == e - 1) {
-                num_targets = i;
-                cg.emit(arm(i)->ptrn(), matcher);
-                otherwise = JumpTarget({arm(i)->location().front(), "otherwise"});
+/**
+ * Compiles the arms of a @p MatchExpr into a decision tree.
+ * Rows of the pattern matrix are arms, columns are sub-values of the matcher.
+ * Each node tests one column with a @p match and specializes the matrix for each outcome.
+ * Thus, each sub-value is tested at most once on every path from the root to an arm.
+ * Alternatives are expanded into one row each.
+ * Integer columns are split into disjoint segments of values which are tested with a dense @p match
+ * if there are at most @p max_match_cases values and by binary search over the segments otherwise.
+ */
+class DecisionTree {
+public:
+    struct Row {
+        std::vector<const Ptrn*> ptrns; ///< @c nullptr is a wildcard.
+        size_t arm;
+    };
+    typedef std::vector<Row> Rows;
+    typedef std::vector<const Def*> Values;
+
+    DecisionTree(CodeGen& cg, Location location, Array<JumpTarget>& arm_targets)
+        : cg_(cg)
+        , location_(location)
+        , arm_targets_(arm_targets)
+    {}
+
+    void emit(const Rows&, const Values&);
+
+private:
+    static const size_t max_match_cases = 512;
+
+    /// Inclusive interval of keys - signed values are biased so that keys order like the values.
+    struct Interval {
+        uint64_t lo, hi;
+
+        bool contains(const Interval& other) const { return lo <= other.lo && other.hi <= hi; }
+    };
+    struct Segment {
+        Interval interval;
+        std::vector<size_t> rows; ///< Non-wildcard rows that match all values of @p interval.
+    };
+
+    static bool is_wildcard(const Ptrn* ptrn) { return ptrn == nullptr || ptrn->isa<IdPtrn>(); }
+    static const OptionDecl* option_decl(const Ptrn* ptrn) { return ptrn->as<EnumPtrn>()->path()->decl()->as<OptionDecl>(); }
+
+    /// Replaces column @p col of @p v with @p with.
+    template<class T>
+    static std::vector<T> replace(const std::vector<T>& v, size_t col, const std::vector<T>& with) {
+        std::vector<T> result(v.begin(), v.begin() + col);
+        result.insert(result.end(), with.begin(), with.end());
+        result.insert(result.end(), v.begin() + col + 1, v.end());
+        return result;
+    }
+
+    static uint64_t bias(const Type* type) { return is_signed(type) ? UINT64_C(1) << 63 : 0; }
+    static uint64_t key(const LiteralPtrn* ptrn) { return uint64_t(ptrn->get_s64()) ^ bias(ptrn->type()); }
+    static Interval interval(const Ptrn*);
+    /// All keys of @p type.
+    static Interval domain(const Type* type);
+    const Def* literal(const Type* type, uint64_t key);
+
+    void emit_tuple(const Rows&, const Values&, size_t col, size_t num_elems);
+    void emit_enum(const Rows&, const Values&, size_t col);
+    void emit_int(const Rows&, const Values&, size_t col);
+    void emit_literal(const Rows&, const Values&, size_t col);
+    void emit_switch(const Def* value, const Type* type, const std::vector<Segment>&, Array<JumpTarget>& targets, JumpTarget& otherwise);
+    void emit_search(const Def* value, const Type* type, const std::vector<Segment>&, Array<JumpTarget>& targets, JumpTarget& otherwise,
+                     size_t begin, size_t end, Interval known);
+    /// Replaces the alternatives in column @p col by one row per alternative.
+    static Rows expand_alts(const Rows&, size_t col);
+    /// Rows with a wildcard in column @p col - they match whatever the other rows don't.
+    Rows default_rows(const Rows&, size_t col);
+
+    CodeGen& cg_;
+    Location location_;
+    Array<JumpTarget>& arm_targets_;
+};
+
+void DecisionTree::emit(const Rows& rows, const Values& values) {
+    // the last arm is always taken, so there is at least one row
+    assert(!rows.empty());
+    const auto& first = rows.front();
+
+    for (size_t col = 0, e = first.ptrns.size(); col != e; ++col) {
+        auto ptrn = first.ptrns[col];
+        if (ptrn == nullptr || !ptrn->is_refutable())
+            continue;
+
+        if (std::any_of(rows.begin(), rows.end(), [&] (const Row& row) { return row.ptrns[col] && row.ptrns[col]->isa<OrPtrn>(); }))
+            return emit(expand_alts(rows, col), values);
+        if (auto tuple = ptrn->isa<TuplePtrn>())
+            return emit_tuple(rows, values, col, tuple->num_elems());
+        if (ptrn->isa<EnumPtrn>())
+            return emit_enum(rows, values, col);
+        if (is_int(ptrn->type()))
+            return emit_int(rows, values, col);
+        return emit_literal(rows, values, col);
+    }
+
+    // first row matches
+    cg_.jump(arm_targets_[first.arm], location_.back());
+}
+
+DecisionTree::Rows DecisionTree::expand_alts(const Rows& rows, size_t col) {
+    Rows result;
+    for (const auto& row : rows) {
+        auto or_ptrn = row.ptrns[col] ? row.ptrns[col]->isa<OrPtrn>() : nullptr;
+        if (or_ptrn == nullptr) {
+            result.push_back(row);
+            continue;
+        }
+        for (const auto& alt : or_ptrn->alts())
+            result.push_back({replace(row.ptrns, col, {alt.get()}), row.arm});
+    }
+    return result;
+}
+
+DecisionTree::Rows DecisionTree::default_rows(const Rows& rows, size_t col) {
+    Rows result;
+    for (const auto& row : rows) {
+        if (is_wildcard(row.ptrns[col]))
+            result.push_back({replace(row.ptrns, col, {}), row.arm});
+    }
+    return result;
+}
+
+void DecisionTree::emit_tuple(const Rows& rows, const Values& values, size_t col, size_t num_elems) {
+    Rows result;
+    for (const auto& row : rows) {
+        std::vector<const Ptrn*> elems(num_elems, nullptr);
+        if (!is_wildcard(row.ptrns[col])) {
+            auto tuple = row.ptrns[col]->as<TuplePtrn>();
+            for (size_t i = 0; i != num_elems; ++i)
+                elems[i] = tuple->elem(i);
+        }
+        result.push_back({replace(row.ptrns, col, elems), row.arm});
+    }
+
+    Values elems(num_elems);
+    for (size_t i = 0; i != num_elems; ++i)
+        elems[i] = cg_.extract(values[col], i, location_);
+    emit(result, replace(values, col, elems));
+}
+
+void DecisionTree::emit_enum(const Rows& rows, const Values& values, size_t col) {
+    std::vector<const OptionDecl*> options;
+    for (const auto& row : rows) {
+        if (!is_wildcard(row.ptrns[col])) {
+            auto option = option_decl(row.ptrns[col]);
+            if (std::find(options.begin(), options.end(), option) == options.end())
+                options.push_back(option);
+        }
+    }
+
+    auto value = values[col];
+    JumpTarget otherwise({location_, "otherwise"});
+    Array<const Def*> defs(options.size());
+    Array<JumpTarget> targets(options.size());
+    for (size_t i = 0, e = options.size(); i != e; ++i) {
+        defs[i] = cg_.world().literal_qu32(options[i]->index(), location_);
+        targets[i] = JumpTarget({options[i]->location(), "case"});
+    }
+    cg_.match(cg_.world().extract(value, 0_u32, location_), otherwise, defs, targets, {location_, "match"});
+
+    for (size_t i = 0, e = options.size(); i != e; ++i) {
+        if (!cg_.enter(targets[i]))
+            continue;
+
+        auto option = options[i];
+        auto num_args = option->num_args();
+        Values args(num_args);
+        if (num_args != 0) {
+            auto variant = cg_.world().cast(option->variant_type(cg_), cg_.world().extract(value, 1, location_), location_);
+            for (size_t j = 0; j != num_args; ++j)
+                args[j] = num_args == 1 ? variant : cg_.extract(variant, j, location_);
+        }
+
+        Rows result;
+        for (const auto& row : rows) {
+            auto ptrn = row.ptrns[col];
+            std::vector<const Ptrn*> ptrns(num_args, nullptr);
+            if (!is_wildcard(ptrn)) {
+                if (option_decl(ptrn) != option)
+                    continue;
+                for (size_t j = 0; j != num_args; ++j)
+                    ptrns[j] = ptrn->as<EnumPtrn>()->arg(j);
+            }
+            result.push_back({replace(row.ptrns, col, ptrns), row.arm});
+        }
+        emit(result, replace(values, col, args));
+    }
+
+    if (cg_.enter(otherwise))
+        emit(default_rows(rows, col), replace(values, col, {}));
+}
+
+DecisionTree::Interval DecisionTree::interval(const Ptrn* ptrn) {
+    if (auto range = ptrn->isa<RangePtrn>())
+        return {key(range->lo()), key(range->hi())};
+    auto k = key(ptrn->as<LiteralPtrn>());
+    return {k, k};
+}
+
+DecisionTree::Interval DecisionTree::domain(const Type* type) {
+    auto bits = num_bits(type);
+    auto max = bits == 64 ? UINT64_MAX : (UINT64_C(1) << bits) - 1;
+    if (!is_signed(type))
+        return {0, max};
+    auto max_signed = max >> 1;
+    return {uint64_t(-int64_t(max_signed) - 1) ^ bias(type), max_signed ^ bias(type)};
+}
+
+const Def* DecisionTree::literal(const Type* type, uint64_t key) {
+    auto value = key ^ bias(type);
+    switch (type->as<PrimType>()->primtype_tag()) {
+        case PrimType_i8:  return cg_.world().literal_qs8 ( int8_t(value), location_);
+        case PrimType_i16: return cg_.world().literal_qs16(int16_t(value), location_);
+        case PrimType_i32: return cg_.world().literal_qs32(int32_t(value), location_);
+        case PrimType_i64: return cg_.world().literal_qs64(int64_t(value), location_);
+        case PrimType_u8:  return cg_.world().literal_pu8 ( uint8_t(value), location_);
+        case PrimType_u16: return cg_.world().literal_pu16(uint16_t(value), location_);
+        case PrimType_u32: return cg_.world().literal_pu32(uint32_t(value), location_);
+        case PrimType_u64: return cg_.world().literal_pu64(uint64_t(value), location_);
+        default: THORIN_UNREACHABLE;
+    }
+}
+
+void DecisionTree::emit_int(const Rows& rows, const Values& values, size_t col) {
+    auto type = rows.front().ptrns[col]->type();
+
+    // split the keys at all bounds: each row matches either all or none of the keys between two bounds
+    std::vector<Interval> intervals(rows.size());
+    std::vector<uint64_t> bounds;
+    for (size_t r = 0, e = rows.size(); r != e; ++r) {
+        if (is_wildcard(rows[r].ptrns[col]))
+            continue;
+        intervals[r] = interval(rows[r].ptrns[col]);
+        bounds.push_back(intervals[r].lo);
+        if (intervals[r].hi != UINT64_MAX)
+            bounds.push_back(intervals[r].hi + 1);
+    }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+    // adjacent pieces matched by the same rows are merged into one segment
+    std::vector<Segment> segments;
+    for (size_t i = 0, e = bounds.size(); i != e; ++i) {
+        Interval piece{bounds[i], i + 1 != e ? bounds[i + 1] - 1 : UINT64_MAX};
+        std::vector<size_t> matching;
+        for (size_t r = 0, e = rows.size(); r != e; ++r) {
+            if (!is_wildcard(rows[r].ptrns[col]) && intervals[r].contains(piece))
+                matching.push_back(r);
+        }
+        if (matching.empty())
+            continue; // left to the default rows
+        if (!segments.empty() && segments.back().interval.hi + 1 == piece.lo && segments.back().rows == matching)
+            segments.back().interval.hi = piece.hi;
+        else
+            segments.push_back({piece, std::move(matching)});
+    }
+
+    JumpTarget otherwise({location_, "otherwise"});
+    Array<JumpTarget> targets(segments.size());
+    for (auto& target : targets)
+        target = JumpTarget({location_, "case"});
+    emit_switch(values[col], type, segments, targets, otherwise);
+
+    auto rest = replace(values, col, {});
+    for (size_t i = 0, e = segments.size(); i != e; ++i) {
+        if (!cg_.enter(targets[i]))
+            continue;
+
+        const auto& matching = segments[i].rows;
+        Rows result;
+        for (size_t r = 0, e = rows.size(); r != e; ++r) {
+            if (is_wildcard(rows[r].ptrns[col]) || std::binary_search(matching.begin(), matching.end(), r))
+                result.push_back({replace(rows[r].ptrns, col, {}), rows[r].arm});
+        }
+        emit(result, rest);
+    }
+    if (cg_.enter(otherwise))
+        emit(default_rows(rows, col), rest);
+}
+
+void DecisionTree::emit_switch(const Def* value, const Type* type, const std::vector<Segment>& segments,
+                               Array<JumpTarget>& targets, JumpTarget& otherwise) {
+    size_t num_cases = 0;
+    for (const auto& segment : segments) {
+        auto size = segment.interval.hi - segment.interval.lo;
+        num_cases += size < max_match_cases ? size + 1 : max_match_cases + 1;
+        if (num_cases > max_match_cases)
+            return emit_search(value, type, segments, targets, otherwise, 0, segments.size(), domain(type));
+    }
+
+    // compact value space: a single match with one case per value
+    Array<const Def*> defs(num_cases);
+    Array<size_t> case_segments(num_cases);
+    for (size_t i = 0, s = 0, e = segments.size(); s != e; ++s) {
+        for (auto k = segments[s].interval.lo; ; ++k) {
+            defs[i] = literal(type, k);
+            case_segments[i++] = s;
+            if (k == segments[s].interval.hi)
                 break;
-            } else {
-                if (is_integer) {
-                    defs[i] = arm(i)->ptrn()->as<LiteralPtrn>()->emit_literal(cg);
-                } else {
-                    auto enum_ptrn = arm(i)->ptrn()->as<EnumPtrn>();
-                    auto option_decl = enum_ptrn->path()->decl()->as<OptionDecl>();
-                    defs[i] = cg.world().literal_qu32(option_decl->index(), arm(i)->ptrn()->location());
-                }
-                targets[i] = JumpTarget({arm(i)->location().front(), "case"});
+        }
+    }
+
+    if (num_cases == segments.size()) {
+        cg_.match(value, otherwise, defs, targets, {location_, "match"});
+        return;
+    }
+
+    Array<JumpTarget> cases(num_cases);
+    for (auto& c : cases)
+        c = JumpTarget({location_, "case"});
+    cg_.match(value, otherwise, defs, cases, {location_, "match"});
+    for (size_t i = 0; i != num_cases; ++i) {
+        if (cg_.enter(cases[i]))
+            cg_.jump(targets[case_segments[i]], location_);
+    }
+}
+
+void DecisionTree::emit_search(const Def* value, const Type* type, const std::vector<Segment>& segments,
+                               Array<JumpTarget>& targets, JumpTarget& otherwise, size_t begin, size_t end, Interval known) {
+    if (end - begin == 1) {
+        // only test the bounds that the search hasn't established yet
+        const auto& interval = segments[begin].interval;
+        bool test_lo = known.lo < interval.lo, test_hi = interval.hi < known.hi;
+        const Def* cond = nullptr;
+        if (test_lo && test_hi && interval.lo == interval.hi) {
+            cond = cg_.world().cmp_eq(value, literal(type, interval.lo), location_);
+        } else {
+            if (test_lo)
+                cond = cg_.world().cmp_le(literal(type, interval.lo), value, location_);
+            if (test_hi) {
+                auto below = cg_.world().cmp_le(value, literal(type, interval.hi), location_);
+                cond = cond ? cg_.world().arithop_and(cond, below, location_) : below;
             }
         }
-        targets.shrink(num_targets);
-        defs.shrink(num_targets);
+        if (cond == nullptr)
+            cg_.jump(targets[begin], location_);
+        else
+            cg_.branch(cond, targets[begin], otherwise, location_);
+        return;
+    }
 
-        auto matcher_int = is_integer ? matcher : cg.world().extract(matcher, 0_u32, matcher->debug());
-        cg.match(matcher_int, otherwise, defs, targets, {location().front(), "match"});
+    auto mid = begin + (end - begin) / 2;
+    auto pivot = segments[mid].interval.lo;
+    JumpTarget lt({location_, "search_lt"});
+    JumpTarget ge({location_, "search_ge"});
+    cg_.branch(cg_.world().cmp_lt(value, literal(type, pivot), location_), lt, ge, location_);
+    if (cg_.enter(lt))
+        emit_search(value, type, segments, targets, otherwise, begin, mid, {known.lo, pivot - 1});
+    if (cg_.enter(ge))
+        emit_search(value, type, segments, targets, otherwise, mid, end, {pivot, known.hi});
+}
+
+void DecisionTree::emit_literal(const Rows& rows, const Values& values, size_t col) {
+    // literals are hash-consed: equal values yield the same def
+    Values row_literals(rows.size(), nullptr), literals;
+    for (size_t r = 0, e = rows.size(); r != e; ++r) {
+        if (!is_wildcard(rows[r].ptrns[col])) {
+            auto literal = rows[r].ptrns[col]->as<LiteralPtrn>()->emit_literal(cg_);
+            row_literals[r] = literal;
+            if (std::find(literals.begin(), literals.end(), literal) == literals.end())
+                literals.push_back(literal);
+        }
+    }
 
-        for (size_t i = 0; i < num_targets; i++) {
-            if (cg.enter(targets[i]))
-                cg.emit_jump(arm(i)->expr(), x);
+    auto rest = replace(values, col, {});
+    auto specialize = [&] (const Def* literal) {
+        Rows result;
+        for (size_t r = 0, e = rows.size(); r != e; ++r) {
+            if (row_literals[r] == nullptr || row_literals[r] == literal)
+                result.push_back({replace(rows[r].ptrns, col, {}), rows[r].arm});
         }
-        bool no_otherwise = num_arms() == num_targets;
-        if (!no_otherwise && cg.enter(otherwise))
-            cg.emit_jump(arm(num_targets)->expr(), x);
-    } else {
-        // general case: if/else
-        for (size_t i = 0, e = num_arms(); i != e; ++i) {
-            JumpTarget  cur({arm(i)->location().front(), "case_true"});
-            JumpTarget next({arm(i)->location().front(), "case_false"});
+        return result;
+    };
 
-            arm(i)->ptrn()->emit(cg, matcher);
-            // last pattern will always be taken
-            auto cond = i == e - 1
-                ? cg.world().literal_bool(true, arm(i)->ptrn()->location())
-                : arm(i)->ptrn()->emit_cond(cg, matcher);
+    // a bool is a two-way switch: branch on it once
+    auto value = values[col];
+    if (is_bool(rows.front().ptrns[col]->type())) {
+        JumpTarget t({location_, "case_true"});
+        JumpTarget f({location_, "case_false"});
+        cg_.branch(value, t, f);
+        if (cg_.enter(t))
+            emit(specialize(cg_.world().literal_bool(true, location_)), rest);
+        if (cg_.enter(f))
+            emit(specialize(cg_.world().literal_bool(false, location_)), rest);
+        return;
+    }
 
-            cg.branch(cond, cur, next);
-            if (cg.enter(cur))
-                cg.emit_jump(arm(i)->expr(), x);
+    // no jump tables for floats: test each literal once
+    for (auto literal : literals) {
+        JumpTarget t({location_, "case_true"});
+        JumpTarget f({location_, "case_false"});
+        cg_.branch(cg_.world().cmp_eq(value, literal), t, f);
+        if (cg_.enter(t))
+            emit(specialize(literal), rest);
+        if (!cg_.enter(f))
+            return;
+    }
+    emit(default_rows(rows, col), rest);
+}
 
-            cg.enter(next);
+void MatchExpr::emit_jump(CodeGen& cg, JumpTarget& x) const {
+    auto matcher = cg.remit(expr());
+    Array<JumpTarget> arm_targets(num_arms());
+    DecisionTree::Rows rows;
+    for (size_t i = 0, e = num_arms(); i != e; ++i) {
+        arm_targets[i] = JumpTarget({arm(i)->location().front(), "case"});
+        // last pattern will always be taken
+        rows.push_back({{i == e - 1 ? nullptr : arm(i)->ptrn()}, i});
+    }
+
+    DecisionTree(cg, location(), arm_targets).emit(rows, {matcher});
+
+    for (size_t i = 0, e = num_arms(); i != e; ++i) {
+        if (cg.enter(arm_targets[i])) {
+            cg.emit(arm(i)->ptrn(), matcher);
+            cg.emit_jump(arm(i)->expr(), x);
         }
     }
     cg.jump(x, location().back());
@@ -849,6 +2435,7 @@ void WhileExpr::emit_jump(CodeGen& cg, JumpTarget& exit_bb) const {
     cg.enter_unsealed(head_bb);
     cg.emit_branch(cond(), body_bb, exit_bb);
     if (cg.enter(body_bb)) {
+        cg.mark_loop(loop_hints(this), body()->location().front());
         cg.remit(body());
         cg.jump_to_continuation(continue_continuation, cond()->location().back());
     }
@@ -870,9 +2457,22 @@ const Def* ForExpr::remit(CodeGen& cg) const {
     auto map_expr = forexpr->as<MapExpr>();
     for (const auto& arg : map_expr->args())
         defs.push_back(cg.remit(arg.get()));
+    cg.for_loop_hints = loop_hints(this);
     defs.push_back(cg.remit(fn_expr()));
     defs.push_back(break_continuation);
     auto fun = cg.remit(map_expr->lhs());
+    // #[unroll] without a count unrolls completely via partial evaluation - like @@ on the call
+    auto unroll = attr("unroll");
+    if (unroll && unroll->num_args() == 0)
+        fun = cg.world().run(fun, map_expr->location());
+
+    // #[chunked(N)] and #[dynamic(N)] make parallel iterate over chunks - a plain #[chunked] keeps the runtime's default
+    auto chunked = attr("chunked");
+    auto dynamic = attr("dynamic");
+    if ((dynamic || (chunked && chunked->num_args() == 1)) && cg.is_reachable()) {
+        auto schedule = dynamic ? dynamic : chunked;
+        cg.schedule_parallel(defs, dynamic != nullptr, schedule->num_args() == 1 ? schedule->arg(0) : 0, location());
+    }
 
     defs.front() = cg.get_mem(); // now get the current memory monad
     cg.call(fun, defs, nullptr, map_expr->location());
@@ -958,6 +2558,25 @@ const thorin::Def* LiteralPtrn::emit_cond(CodeGen& cg, const thorin::Def* init)
     return cg.world().cmp_eq(init, emit_literal(cg));
 }
 
+void RangePtrn::emit(CodeGen&, const thorin::Def*) const {}
+
+const thorin::Def* RangePtrn::emit_cond(CodeGen& cg, const thorin::Def* init) const {
+    auto above = cg.world().cmp_le(lo()->emit_literal(cg), init, location());
+    auto below = cg.world().cmp_le(init, hi()->emit_literal(cg), location());
+    return cg.world().arithop_and(above, below, location());
+}
+
+void OrPtrn::emit(CodeGen&, const thorin::Def*) const {}
+
+const thorin::Def* OrPtrn::emit_cond(CodeGen& cg, const thorin::Def* init) const {
+    const Def* cond = nullptr;
+    for (const auto& alt : alts()) {
+        auto next = alt->emit_cond(cg, init);
+        cond = cond ? cg.world().arithop_or(cond, next, location()) : next;
+    }
+    return cond;
+}
+
 /*
  * statements
  */
@@ -972,7 +2591,13 @@ void ItemStmt::emit(CodeGen& cg) const {
 }
 
 void LetStmt::emit(CodeGen& cg) const {
-    if (cg.is_reachable())
+    if (!cg.is_reachable())
+        return;
+    auto repeated = init() ? init()->isa<RepeatedDefiniteArrayExpr>() : nullptr;
+    auto id_ptrn = ptrn()->isa<IdPtrn>();
+    if (repeated && RepeatedDefiniteArrayExpr::is_compact(cg.count(repeated)) && id_ptrn)
+        cg.emit_filled(id_ptrn->local(), repeated);
+    else
         cg.emit(ptrn(), init() ? cg.remit(init()) : cg.world().bottom(cg.convert(ptrn()->type()), ptrn()->location()));
 }
 
@@ -1001,15 +2626,18 @@ void AsmStmt::emit(CodeGen& cg) const {
     size_t i = 0;
     cg.set_mem(assembly->out(i++));
     for (const auto& output: outputs())
-        cg.lemit(output->expr()).store(assembly->out(i++), location());
+        cg.store_lvalue(output->expr(), cg.lemit(output->expr()), assembly->out(i++), location());
 }
 
 //------------------------------------------------------------------------------
 
-void emit(World& world, const Module* mod) {
-    CodeGen cg(world);
+size_t emit(World& world, const Module* mod, LLVMAnnotations& annotations, bool bounds_checks, bool fast_math) {
+    CodeGen cg(world, annotations, bounds_checks, fast_math);
+    cg.collect_toplevel(mod);
     mod->emit(cg);
     clear_value_numbering_table(world);
+    // items emitted on demand may be referenced from anywhere in the program: count only once everything is emitted
+    return cg.num_skipped(mod);
 }
 
 //------------------------------------------------------------------------------
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "thorin/world.h"
@@ -18,15 +19,44 @@ class ASTNode;
 class Item;
 class Module;
 typedef std::vector<std::unique_ptr<const Item>> Items;
+/// Files read by @c include_bytes expressions as (path, contents) pairs.
+typedef std::vector<std::pair<std::string, std::string>> IncludedFiles;
 
 void init();
-void parse(Items&, std::istream&, const char*);
+void parse(Items&, std::istream&, const char*, IncludedFiles* included = nullptr);
 void name_analysis(const Module*);
 void type_inference(std::unique_ptr<TypeTable>& typetable, const Module*);
 void type_analysis(const Module*, bool nossa);
 //void borrow_check(const ModContents*);
 void check(std::unique_ptr<TypeTable>& typetable, const Module*, bool nossa);
-void emit(thorin::World&, const Module*);
+
+/// LLVM attributes of a function which thorin can't carry - applied to the emitted module by @c finish_llvm.
+struct LLVMFnAnnotation {
+    std::string name;     ///< Name of the external continuation thorin emits the function as.
+    std::string symbol;   ///< Name of the function in the final module.
+    bool internal = true; ///< Only made external to keep thorin from inlining or dropping it.
+    bool noinline = false, hot = false, cold = false;
+    std::string target_cpu, target_features;
+    std::vector<size_t> noalias; ///< Indices of @c noalias parameters among the pointer parameters.
+};
+
+/// Contents of the global <tt>impala.blob.K</tt> which thorin emits uninitialized - K is the index in @c LLVMAnnotations::blobs.
+struct LLVMBlob {
+    std::string bytes;
+    bool is_mut = false;
+};
+
+/// What the LLVM modules thorin emits need beyond thorin's IR; collected by @c emit.
+struct LLVMAnnotations {
+    std::vector<LLVMFnAnnotation> fns;
+    std::vector<LLVMBlob> blobs;
+};
+
+/**
+ * Emits all items reachable from @c main, @c extern functions and @c pub items; returns the number of skipped items.
+ * Reports an error if instances of generic functions nest too deeply.
+ */
+size_t emit(thorin::World&, const Module*, LLVMAnnotations&, bool bounds_checks = true, bool fast_math = false);
 
 enum class Prec {
     Bottom,
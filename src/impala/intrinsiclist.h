@@ -0,0 +1,48 @@
+#ifndef IMPALA_INTRINSIC
+#define IMPALA_INTRINSIC(name, primop)
+#endif
+
+// functions declared in an 'extern "thorin"' block which are handled by the front end
+// primop: calls are lowered in place to thorin primops or LLVM intrinsics; no function is emitted for the declaration
+
+IMPALA_INTRINSIC(bitcast,        true)
+IMPALA_INTRINSIC(select,         true)
+IMPALA_INTRINSIC(insert,         true)
+IMPALA_INTRINSIC(sizeof,         true)
+IMPALA_INTRINSIC(undef,          false)
+IMPALA_INTRINSIC(reserve_shared, false)
+IMPALA_INTRINSIC(atomic,         false)
+IMPALA_INTRINSIC(cmpxchg,        false)
+IMPALA_INTRINSIC(cmpxchg_weak,   true)
+IMPALA_INTRINSIC(atomic_load,    true)
+IMPALA_INTRINSIC(atomic_store,   true)
+IMPALA_INTRINSIC(fence,          true)
+IMPALA_INTRINSIC(pe_info,        false)
+IMPALA_INTRINSIC(pe_known,       false)
+// lowered by thorin to calls into the runtime - see anydsl_parallel_for in test/lib.c
+IMPALA_INTRINSIC(parallel,       false)
+IMPALA_INTRINSIC(spawn,          false)
+IMPALA_INTRINSIC(sync,           false)
+
+// simd and memory - see check_intrinsic in typesema.cpp for the signatures
+IMPALA_INTRINSIC(shuffle,        true)
+IMPALA_INTRINSIC(reduce_add,     true)
+IMPALA_INTRINSIC(reduce_mul,     true)
+IMPALA_INTRINSIC(reduce_min,     true)
+IMPALA_INTRINSIC(reduce_max,     true)
+IMPALA_INTRINSIC(gather,         true)
+IMPALA_INTRINSIC(scatter,        true)
+IMPALA_INTRINSIC(masked_load,    true)
+IMPALA_INTRINSIC(masked_store,   true)
+IMPALA_INTRINSIC(prefetch,       true)
+IMPALA_INTRINSIC(store_nontemporal, true)
+
+// integer arithmetic on scalars and simd vectors - see check_intrinsic in typesema.cpp for the signatures
+IMPALA_INTRINSIC(add_sat,        true)
+IMPALA_INTRINSIC(sub_sat,        true)
+IMPALA_INTRINSIC(add_overflow,   true)
+IMPALA_INTRINSIC(sub_overflow,   true)
+IMPALA_INTRINSIC(mul_overflow,   true)
+IMPALA_INTRINSIC(mulhi,          true)
+
+#undef IMPALA_INTRINSIC
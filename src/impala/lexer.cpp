@@ -163,6 +163,7 @@ Token Lexer::lex() {
         if (accept(',')) return {location(), Token::COMMA};
         if (accept(';')) return {location(), Token::SEMICOLON};
         if (accept('$')) return {location(), Token::HLT};
+        if (accept('#')) return {location(), Token::HASH};
         if (accept('[')) return {location(), Token::L_BRACKET};
         if (accept(']')) return {location(), Token::R_BRACKET};
         if (accept('{')) return {location(), Token::L_BRACE};
@@ -238,7 +239,8 @@ Token Lexer::lex() {
 
 l_dec:                                      // [0-9_]*
         while (accept(str, dec) || accept(str, '_')) {}
-        if (accept(str, '.')) {             // [0-9]
+        // "1..9" is a range and not the float "1." followed by ".9"
+        if (peek() == '.' && peek2() != '.' && accept(str, '.')) { // [0-9]
             if (accept(str, dec)) goto l_fractional_dot_rest;
             if (accept(str,  eE)) goto l_exp;
             return lex_suffix(str, true);
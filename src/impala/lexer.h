@@ -21,6 +21,13 @@ private:
     Token literal_error(std::string&, bool floating);
     int next();
     int peek() const { return stream_.peek(); }
+    /// Looks two chars ahead without consuming anything.
+    int peek2() const {
+        stream_.get();
+        int c = stream_.peek();
+        stream_.unget();
+        return c;
+    }
     Location location() const { return {filename_, front_line_, front_col_, back_line_, back_col_}; }
     Location curr() const { return location().back(); }
 
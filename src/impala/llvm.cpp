@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Analysis/VectorUtils.h>
+#include <llvm/AsmParser/Parser.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_os_ostream.h>
+#if LLVM_VERSION_MAJOR >= 14
+#include <llvm/MC/TargetRegistry.h>
+#else
+#include <llvm/Support/TargetRegistry.h>
+#endif
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/IPO/PassManagerBuilder.h>
+
+#include "impala/llvm.h"
+
+namespace impala {
+
+static void annotate(llvm::Module& module, const LLVMFnAnnotation& annotation) {
+    auto fn = module.getFunction(annotation.name);
+    if (fn == nullptr) // unused declarations are not emitted
+        return;
+
+    if (annotation.noinline) {
+        fn->removeFnAttr(llvm::Attribute::AlwaysInline);
+        fn->addFnAttr(llvm::Attribute::NoInline);
+    }
+#if LLVM_VERSION_MAJOR >= 12
+    if (annotation.hot)
+        fn->addFnAttr(llvm::Attribute::Hot);
+#else
+    if (annotation.hot) // there is no hot attribute before LLVM 12
+        fn->addFnAttr(llvm::Attribute::InlineHint);
+#endif
+    if (annotation.cold)
+        fn->addFnAttr(llvm::Attribute::Cold);
+    if (!annotation.target_cpu.empty()) {
+        fn->removeFnAttr("target-cpu");
+        fn->addFnAttr("target-cpu", annotation.target_cpu);
+    }
+    if (!annotation.target_features.empty()) {
+        fn->removeFnAttr("target-features");
+        fn->addFnAttr("target-features", annotation.target_features);
+    }
+
+    // thorin passes pointers as they are - the n-th pointer parameter of the function is the n-th one in LLVM
+    size_t num_ptrs = 0;
+    for (auto& arg : fn->args()) {
+        if (!arg.getType()->isPointerTy())
+            continue;
+        if (std::find(annotation.noalias.begin(), annotation.noalias.end(), num_ptrs++) != annotation.noalias.end())
+            arg.addAttr(llvm::Attribute::NoAlias);
+    }
+
+    if (annotation.internal) {
+        fn->setLinkage(llvm::GlobalValue::InternalLinkage);
+        fn->setName(annotation.symbol); // LLVM appends a suffix if several instances share the symbol
+    }
+}
+
+/// The parts of the name of a pseudo function like <tt>impala.fmath.fadd.reassoc.f32</tt> between its dots.
+static std::vector<std::string> split_name(llvm::StringRef name) {
+    llvm::SmallVector<llvm::StringRef, 8> parts;
+    name.split(parts, '.');
+    return std::vector<std::string>(parts.begin(), parts.end());
+}
+
+/// Aligns the atomic access @p inst of @p type naturally - LLVM requires an explicit alignment.
+template<class I>
+static void align_naturally(I* inst, llvm::Type* type) {
+    uint64_t size = inst->getModule()->getDataLayout().getTypeStoreSize(type);
+#if LLVM_VERSION_MAJOR >= 10
+    inst->setAlignment(llvm::Align(size));
+#else
+    inst->setAlignment(unsigned(size));
+#endif
+}
+
+/// The instruction the call of the pseudo function named @p parts stands for, null if the call has no result.
+static llvm::Value* lower(llvm::IRBuilder<>& builder, const std::vector<std::string>& parts, llvm::CallInst* call) {
+    auto arg = [&] (unsigned i) { return call->getArgOperand(i); };
+    // orderings are given by their value in llvm::AtomicOrdering
+    auto ordering = [&] (size_t i) { return llvm::AtomicOrdering(std::stoi(parts[i])); };
+
+    if (parts[1] == "load") {
+        auto load = builder.CreateLoad(call->getType(), arg(0));
+        load->setAtomic(ordering(2));
+        align_naturally(load, call->getType());
+        return load;
+    }
+    if (parts[1] == "store") {
+        auto store = builder.CreateStore(arg(1), arg(0));
+        if (parts[2] == "nontemporal") {
+            // LLVM expects the metadata !{i32 1}
+            auto one = llvm::ConstantAsMetadata::get(builder.getInt32(1));
+            store->setMetadata(llvm::LLVMContext::MD_nontemporal, llvm::MDNode::get(call->getContext(), one));
+            return nullptr;
+        }
+        store->setAtomic(ordering(2));
+        align_naturally(store, arg(1)->getType());
+        return nullptr;
+    }
+    if (parts[1] == "fence") {
+        builder.CreateFence(ordering(2));
+        return nullptr;
+    }
+    if (parts[1] == "atomicrmw") {
+        auto op = llvm::AtomicRMWInst::BinOp(std::stoi(parts[2]));
+#if LLVM_VERSION_MAJOR >= 13
+        return builder.CreateAtomicRMW(op, arg(0), arg(1), llvm::MaybeAlign(), ordering(3));
+#else
+        return builder.CreateAtomicRMW(op, arg(0), arg(1), ordering(3));
+#endif
+    }
+    if (parts[1] == "cmpxchg") {
+#if LLVM_VERSION_MAJOR >= 13
+        auto cmpxchg = builder.CreateAtomicCmpXchg(arg(0), arg(1), arg(2), llvm::MaybeAlign(), ordering(2), ordering(3));
+#else
+        auto cmpxchg = builder.CreateAtomicCmpXchg(arg(0), arg(1), arg(2), ordering(2), ordering(3));
+#endif
+        cmpxchg->setWeak(parts[4] == "weak");
+        // thorin's (T, bool) is LLVM's { T, i1 } - but rebuild it in the type of the call to be sure
+        llvm::Value* result = llvm::UndefValue::get(call->getType());
+        result = builder.CreateInsertValue(result, builder.CreateExtractValue(cmpxchg, 0), 0);
+        return builder.CreateInsertValue(result, builder.CreateExtractValue(cmpxchg, 1), 1);
+    }
+
+    if (parts[1] == "fmath") {
+        auto opcode = parts[2] == "fadd" ? llvm::Instruction::FAdd
+                    : parts[2] == "fsub" ? llvm::Instruction::FSub
+                    : parts[2] == "fmul" ? llvm::Instruction::FMul
+                    : parts[2] == "fdiv" ? llvm::Instruction::FDiv
+                    :                      llvm::Instruction::FRem;
+        llvm::FastMathFlags flags;
+        for (size_t i = 3, e = parts.size() - 1; i != e; ++i) {
+            if (parts[i] == "reassoc")  flags.setAllowReassoc();
+            if (parts[i] == "contract") flags.setAllowContract(true);
+            if (parts[i] == "nnan")     flags.setNoNaNs();
+            if (parts[i] == "ninf")     flags.setNoInfs();
+            if (parts[i] == "arcp")     flags.setAllowReciprocal();
+        }
+        auto result = builder.CreateBinOp(opcode, arg(0), arg(1));
+        if (auto inst = llvm::dyn_cast<llvm::Instruction>(result))
+            inst->setFastMathFlags(flags);
+        return result;
+    }
+
+    throw std::runtime_error("unknown pseudo function '" + call->getCalledFunction()->getName().str() + "'");
+}
+
+/// Replaces the calls of the pseudo functions <tt>impala.*</tt> - see @c CodeGen::call_pseudo; the loop markers are left to @c annotate_loops.
+static void lower_pseudo_calls(llvm::Module& module) {
+    std::vector<llvm::Function*> pseudos;
+    for (auto& fn : module) {
+        if (fn.getName().startswith("impala.") && !fn.getName().startswith("impala.loop."))
+            pseudos.push_back(&fn);
+    }
+
+    for (auto fn : pseudos) {
+        auto parts = split_name(fn->getName());
+        while (!fn->use_empty()) {
+            auto call = llvm::dyn_cast<llvm::CallInst>(fn->user_back());
+            if (call == nullptr)
+                throw std::runtime_error("pseudo function '" + fn->getName().str() + "' is not called directly");
+            llvm::IRBuilder<> builder(call);
+            if (auto result = lower(builder, parts, call))
+                call->replaceAllUsesWith(result);
+            call->eraseFromParent();
+        }
+        fn->eraseFromParent();
+    }
+}
+
+/// Adds the hints @p parts of a loop marker like <tt>impala.loop.unroll4.parallel</tt> to the @c llvm.loop metadata of @p loop.
+static void annotate(llvm::Loop* loop, const std::vector<std::string>& parts) {
+    auto& context = loop->getHeader()->getContext();
+    auto property = [&] (const char* name, llvm::Metadata* value) -> llvm::Metadata* {
+        auto key = llvm::MDString::get(context, name);
+        return value ? llvm::MDNode::get(context, {key, value}) : llvm::MDNode::get(context, key);
+    };
+    auto i32 = [&] (const std::string& digits) { return llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(llvm::Type::getInt32Ty(context), std::stoul(digits))); };
+
+    // the first operand of a loop id is the loop id itself; keep the properties of an earlier marker of the same loop
+    std::vector<llvm::Metadata*> ops = { nullptr };
+    if (auto id = loop->getLoopID())
+        ops.insert(ops.end(), id->op_begin() + 1, id->op_end());
+
+    for (size_t i = 2, e = parts.size(); i != e; ++i) {
+        llvm::StringRef hint = parts[i];
+        if (hint == "nounroll") {
+            ops.push_back(property("llvm.loop.unroll.disable", nullptr));
+        } else if (hint.startswith("unroll")) {
+            ops.push_back(property("llvm.loop.unroll.count", i32(hint.drop_front(6).str())));
+        } else if (hint.startswith("vectorize")) {
+            ops.push_back(property("llvm.loop.vectorize.enable", llvm::ConstantAsMetadata::get(llvm::ConstantInt::getTrue(context))));
+            if (hint.size() > 9)
+                ops.push_back(property("llvm.loop.vectorize.width", i32(hint.drop_front(9).str())));
+        } else if (hint == "parallel") {
+            // the iterations are independent: all memory accesses of the loop join one access group
+            auto group = llvm::MDNode::getDistinct(context, {});
+            ops.push_back(property("llvm.loop.parallel_accesses", group));
+            for (auto bb : loop->blocks()) {
+                for (auto& inst : *bb) {
+                    if (inst.mayReadOrWriteMemory())
+                        inst.setMetadata(llvm::LLVMContext::MD_access_group, llvm::uniteAccessGroups(inst.getMetadata(llvm::LLVMContext::MD_access_group), group));
+                }
+            }
+        }
+    }
+
+    auto id = llvm::MDNode::getDistinct(context, ops);
+    id->replaceOperandWith(0, id);
+    loop->setLoopID(id);
+}
+
+/// Attaches the hints of the loop markers <tt>impala.loop.*</tt> - see @c CodeGen::mark_loop - to the innermost loops around their calls.
+static void annotate_loops(llvm::Module& module) {
+    std::vector<llvm::Function*> markers;
+    for (auto& fn : module) {
+        if (fn.getName().startswith("impala.loop."))
+            markers.push_back(&fn);
+    }
+
+    // annotating loops doesn't change the control flow - the loops of each function are analyzed once
+    std::map<llvm::Function*, std::unique_ptr<llvm::LoopInfo>> loop_infos;
+    for (auto marker : markers) {
+        auto parts = split_name(marker->getName());
+        while (!marker->use_empty()) {
+            auto call = llvm::dyn_cast<llvm::CallInst>(marker->user_back());
+            if (call == nullptr)
+                throw std::runtime_error("pseudo function '" + marker->getName().str() + "' is not called directly");
+            auto fn = call->getFunction();
+            auto& loop_info = loop_infos[fn];
+            if (!loop_info) {
+                llvm::DominatorTree dominators(*fn);
+                loop_info.reset(new llvm::LoopInfo(dominators));
+            }
+            // thorin may have unrolled the loop or kept the body of a for loop as a function of its own - the hints are void then
+            if (auto loop = loop_info->getLoopFor(call->getParent()))
+                annotate(loop, parts);
+            call->eraseFromParent();
+        }
+        marker->eraseFromParent();
+    }
+}
+
+/// Sets the bytes of the blobs <tt>impala.blob.K</tt> - see @c CodeGen::blob.
+static void fill_blobs(llvm::Module& module, const std::vector<LLVMBlob>& blobs) {
+    for (auto& global : module.globals()) {
+        auto name = global.getName();
+        if (!name.startswith("impala.blob."))
+            continue;
+        // thorin may append the id of the global as _N
+        auto& blob = blobs.at(std::stoul(name.drop_front(12).str()));
+        auto type = llvm::dyn_cast<llvm::ArrayType>(global.getValueType());
+        if (type == nullptr || module.getDataLayout().getTypeAllocSize(type) != blob.bytes.size())
+            throw std::runtime_error("blob '" + name.str() + "' doesn't fit its global");
+        global.setInitializer(llvm::ConstantDataArray::getRaw(blob.bytes, type->getNumElements(), type->getElementType()));
+        global.setConstant(!blob.is_mut);
+    }
+}
+
+/// Features of the host CPU like <tt>+avx2,-avx512f</tt>.
+static std::string host_features() {
+    std::string result;
+    llvm::StringMap<bool> features;
+    if (llvm::sys::getHostCPUFeatures(features)) {
+        for (const auto& feature : features)
+            result += (result.empty() ? "" : ",") + std::string(feature.getValue() ? "+" : "-") + feature.getKey().str();
+    }
+    return result;
+}
+
+/// Runs LLVM's standard pipeline at @p opt with the cost model of the host.
+static void optimize(llvm::Module& module, int opt) {
+    llvm::InitializeNativeTarget();
+    auto triple = module.getTargetTriple().empty() ? llvm::sys::getDefaultTargetTriple() : module.getTargetTriple();
+    std::string error;
+    std::unique_ptr<llvm::TargetMachine> machine;
+    if (auto target = llvm::TargetRegistry::lookupTarget(triple, error))
+        machine.reset(target->createTargetMachine(triple, llvm::sys::getHostCPUName(), host_features(), llvm::TargetOptions(), {}));
+    if (machine && module.getDataLayoutStr().empty())
+        module.setDataLayout(machine->createDataLayout());
+
+    llvm::PassManagerBuilder builder;
+    builder.OptLevel  = opt < 0 ? 2 : unsigned(opt);
+    builder.SizeLevel = opt < 0 ? 1 : 0;
+    builder.Inliner = llvm::createFunctionInliningPass(builder.OptLevel, builder.SizeLevel, false);
+    builder.LoopVectorize = builder.SLPVectorize = builder.OptLevel > 1;
+
+    llvm::legacy::FunctionPassManager fn_passes(&module);
+    llvm::legacy::PassManager module_passes;
+    if (machine) {
+        machine->adjustPassManager(builder);
+        fn_passes.add(llvm::createTargetTransformInfoWrapperPass(machine->getTargetIRAnalysis()));
+        module_passes.add(llvm::createTargetTransformInfoWrapperPass(machine->getTargetIRAnalysis()));
+    }
+    builder.populateFunctionPassManager(fn_passes);
+    builder.populateModulePassManager(module_passes);
+
+    fn_passes.doInitialization();
+    for (auto& fn : module)
+        fn_passes.run(fn);
+    fn_passes.doFinalization();
+    module_passes.run(module);
+}
+
+void finish_llvm(const std::string& ir, const LLVMAnnotations& annotations, int opt, std::ostream& out) {
+    llvm::LLVMContext context;
+    llvm::SMDiagnostic diag;
+    auto module = llvm::parseAssemblyString(ir, diag, context);
+    if (!module)
+        throw std::runtime_error("cannot read the LLVM module emitted by thorin: " + diag.getMessage().str());
+
+    lower_pseudo_calls(*module);
+    annotate_loops(*module);
+    fill_blobs(*module, annotations.blobs);
+    for (const auto& fn : annotations.fns)
+        annotate(*module, fn);
+
+    std::string broken;
+    llvm::raw_string_ostream broken_stream(broken);
+    if (llvm::verifyModule(*module, &broken_stream))
+        throw std::runtime_error("invalid LLVM module after applying annotations: " + broken_stream.str());
+
+    if (opt != 0)
+        optimize(*module, opt);
+
+    llvm::raw_os_ostream stream(out);
+    module->print(stream, nullptr);
+}
+
+}
@@ -0,0 +1,21 @@
+#ifndef IMPALA_LLVM_H
+#define IMPALA_LLVM_H
+
+#include <ostream>
+#include <string>
+
+#include "impala/impala.h"
+
+namespace impala {
+
+/**
+ * Replaces the calls of the pseudo functions <tt>impala.*</tt> in the LLVM module @p ir which thorin emitted without optimizing it,
+ * applies @p annotations and prints the result to @p out.
+ * The module is optimized at @p opt afterwards for the host like thorin would; @p opt is -1 for @c -Os and 0 leaves it as it is.
+ * Throws @c std::runtime_error if @p ir can't be read.
+ */
+void finish_llvm(const std::string& ir, const LLVMAnnotations& annotations, int opt, std::ostream& out);
+
+}
+
+#endif
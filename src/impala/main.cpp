@@ -1,9 +1,20 @@
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <list>
+#include <sstream>
 #include <vector>
 #include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <stdexcept>
 
 #ifdef LLVM_SUPPORT
+#include <llvm/Support/Host.h>
+
 #include "thorin/be/llvm/llvm.h"
 #endif
 #include "thorin/util/args.h"
@@ -11,13 +22,87 @@
 #include "thorin/util/location.h"
 
 #include "impala/ast.h"
+#include "impala/cache.h"
 #include "impala/cgen.h"
 #include "impala/impala.h"
+#ifdef LLVM_SUPPORT
+#include "impala/llvm.h"
+#endif
+#ifdef IMPALA_SERVER
+#include "impala/server.h"
+#endif
+#ifdef IMPALA_FORK_BACKENDS
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 //------------------------------------------------------------------------------
 
 typedef std::vector<std::string> Names;
 
+/// A parsed and type checked module together with everything its AST refers to.
+struct CheckedModule {
+    Names sources;
+    impala::IncludedFiles included;
+    bool nossa = false;
+    std::list<std::string> file_names; ///< Locations point into these strings.
+    std::unique_ptr<const impala::Module> module;
+    std::unique_ptr<impala::TypeTable> typetable;
+};
+
+/// Measures wall-clock time since construction.
+class Timer {
+public:
+    double ms() const { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count(); }
+
+private:
+    std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+};
+
+/// Restores the level and stream of thorin's log on destruction: a compilation may log to a file it closes when done.
+class LogGuard {
+public:
+    LogGuard()
+        : min_level_(thorin::Log::min_level())
+        , stream_(&thorin::Log::stream())
+    {}
+    ~LogGuard() { thorin::Log::set(min_level_, stream_); }
+
+private:
+    thorin::Log::Level min_level_;
+    std::ostream* stream_;
+};
+
+/// Statistics printed with -stats.
+struct Stats {
+    const char* cache = "off";
+    std::vector<std::pair<std::string, double>> times; ///< Milliseconds per phase.
+    double backends_wall = 0, backends_summed = 0;
+    size_t skipped_items = 0;
+
+    void time(const std::string& phase, double ms) { times.emplace_back(phase, ms); }
+
+    void print(std::ostream& os) const {
+        os << "cache: " << cache << std::endl;
+        os << "unreachable items skipped: " << skipped_items << std::endl;
+        auto flags = os.flags();
+        os << std::fixed << std::setprecision(2);
+        for (const auto& time : times)
+            os << "time: " << time.first << ": " << time.second << " ms" << std::endl;
+        if (backends_wall > 0)
+            os << "time: backends: " << backends_wall << " ms wall, " << backends_summed << " ms summed, overlap "
+               << backends_summed / backends_wall << 'x' << std::endl;
+        os.flags(flags);
+    }
+};
+
+/**
+ * Modules kept resident by the compile server, most recently used first; keyed by @p resident_key of their input files.
+ * Sema checks and annotates the whole program in place, so a module is only shared by compilations of the same input files.
+ */
+static std::list<std::pair<std::string, CheckedModule>> resident_modules;
+static const size_t max_resident_modules = 8;
+
 //------------------------------------------------------------------------------
 
 std::ostream* open(std::ofstream& stream, const std::string& name) {
@@ -28,8 +113,62 @@ std::ostream* open(std::ofstream& stream, const std::string& name) {
     return &stream;
 }
 
+static int compile(const Names& args);
+
+static bool resident() {
+#ifdef IMPALA_SERVER
+    return impala::serving();
+#else
+    return false;
+#endif
+}
+
+/**
+ * Identifies the input files by contents independently of the working directory:
+ * each file by the name it was given, which locations refer to, and the hash of its contents.
+ */
+static std::string resident_key(const Names& infiles, const Names& sources) {
+    impala::Hasher hasher;
+    for (size_t i = 0, e = infiles.size(); i != e; ++i)
+        hasher << infiles[i] << sources[i];
+    return hasher.hash();
+}
+
+/// The resident module for @p key - a new one if there is none; evicts the least recently used module beyond the limit.
+static CheckedModule& resident_module(const std::string& key) {
+    auto i = std::find_if(resident_modules.begin(), resident_modules.end(), [&] (const std::pair<std::string, CheckedModule>& entry) { return entry.first == key; });
+    if (i != resident_modules.end()) {
+        resident_modules.splice(resident_modules.begin(), resident_modules, i);
+    } else {
+        resident_modules.emplace_front(key, CheckedModule());
+        if (resident_modules.size() > max_resident_modules)
+            resident_modules.pop_back();
+    }
+    return resident_modules.front().second;
+}
+
+/// Whether the files read by include_bytes still have the contents recorded in @p included.
+static bool unchanged(const impala::IncludedFiles& included) {
+    for (const auto& file : included) {
+        std::ifstream is(file.first, std::ios::binary);
+        if (!is || std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()) != file.second)
+            return false;
+    }
+    return true;
+}
+
 int main(int argc, char** argv) {
+    impala::init();
+    thorin::Log::set(thorin::Log::Error, &std::cout);
+    return compile(Names(argv, argv + argc));
+}
+
+static int compile(const Names& args) {
     try {
+        std::vector<char*> argv;
+        for (const auto& arg : args)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        int argc = argv.size();
         if (argc < 1)
             throw std::logic_error("bad number of arguments");
 
@@ -39,11 +178,11 @@ int main(int argc, char** argv) {
         Names breakpoints;
         bool track_history;
 #endif
-        std::string out_name, log_name, log_level;
-        bool help,
+        std::string out_name, log_name, log_level, server_socket, cache_dir;
+        bool help, print_stats,
              emit_cint, emit_thorin, emit_ast, emit_annotated,
              emit_llvm, opt_thorin, opt_s, opt_0, opt_1, opt_2, opt_3, debug,
-             nocleanup, nossa, fancy;
+             nocleanup, nossa, no_bounds_checks, fast_math, fancy;
 
 #ifndef NDEBUG
 #define LOG_LEVELS "{error|warn|info|verbose|debug}"
@@ -61,6 +200,11 @@ int main(int argc, char** argv) {
             .add_option<bool>            ("track-history",      "", "track hisotry of names - useful for debugging", track_history, false)
 #endif
             .add_option<std::string>     ("o",                  "", "specifies the output module name", out_name, "")
+            .add_option<std::string>     ("cache-dir",          "<dir>", "reuse output files of identical compilations stored in <dir>", cache_dir, "")
+            .add_option<bool>            ("stats",              "", "print compilation statistics to stderr", print_stats, false)
+#ifdef IMPALA_SERVER
+            .add_option<std::string>     ("server",             "<socket>", "keep running as compile server listening on Unix socket <socket>", server_socket, "")
+#endif
             .add_option<bool>            ("O0",                 "", "reduce compilation time and make debugging produce the expected results (default)", opt_0, false)
             .add_option<bool>            ("O1",                 "", "optimize", opt_1, false)
             .add_option<bool>            ("O2",                 "", "optimize even more", opt_2, false)
@@ -72,18 +216,21 @@ int main(int argc, char** argv) {
             .add_option<bool>            ("emit-c-interface",   "", "emit C interface from Impala code (experimental)", emit_cint, false)
             .add_option<bool>            ("emit-llvm",          "", "emit llvm from Thorin representation (implies -Othorin)", emit_llvm, false)
             .add_option<bool>            ("emit-thorin",        "", "emit textual Thorin representation of Impala program", emit_thorin, false)
+            .add_option<bool>            ("ffast-math",         "", "allow floating-point transformations that may change results, like #[fast_math] on every function", fast_math, false)
             .add_option<bool>            ("f",                  "", "use fancy output: Impala's AST dump uses only parentheses where necessary", fancy, false)
             .add_option<bool>            ("g",                  "", "emit debug information", debug, false)
             .add_option<bool>            ("nocleanup",          "", "no clean-up phase", nocleanup, false)
+            .add_option<bool>            ("no-bounds-checks",   "", "don't check indices and ranges of slices at run time", no_bounds_checks, false)
             .add_option<bool>            ("nossa",              "", "use slots + load/store instead of SSA construction", nossa, false);
 
         // do cmdline parsing
-        cmd_parser.parse(argc, argv);
+        cmd_parser.parse(argc, argv.data());
         opt_thorin |= emit_llvm;
 
         impala::fancy() = fancy;
 
         std::ofstream log_stream;
+        LogGuard log_guard;
         if (log_level == "error") {
             thorin::Log::set(thorin::Log::Error, open(log_stream, log_name));
         } else if (log_level == "warn") {
@@ -107,6 +254,14 @@ int main(int argc, char** argv) {
         else if (opt_2) opt = 2;
         else if (opt_3) opt = 3;
 
+        impala::num_errors() = 0;
+        impala::num_warnings() = 0;
+
+#ifdef IMPALA_SERVER
+        if (!server_socket.empty())
+            return impala::serve(server_socket, compile);
+#endif
+
         if (infiles.empty() && !help) {
             thorin::errf("no input files\n");
             return EXIT_FAILURE;
@@ -137,8 +292,16 @@ int main(int argc, char** argv) {
             }
         }
 
+        Names sources;
+        for (const auto& infile : infiles) {
+            std::ifstream file(infile);
+            sources.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        Stats stats;
+        Names outputs;
+
         thorin::World world(module_name);
-        impala::init();
 
 #if THORIN_ENABLE_CHECKS && !defined(NDEBUG)
         for (auto b : breakpoints) {
@@ -166,20 +329,71 @@ int main(int argc, char** argv) {
         world.enable_history(track_history);
 #endif
 
-        impala::Items items;
-        for (const auto& infile : infiles) {
-            auto filename = infile.c_str();
-            std::ifstream file(filename);
-            impala::parse(items, file, filename);
+        // the compile server reuses the checked module if the sources and the files they include did not change
+        CheckedModule fresh, *checked = &fresh;
+        std::string key;
+        if (resident() && !emit_ast) {
+            key = resident_key(infiles, sources);
+            checked = &resident_module(key);
+            if (checked->sources != sources || checked->nossa != nossa || !unchanged(checked->included))
+                *checked = CheckedModule();
         }
 
-        auto module = std::make_unique<const impala::Module>(infiles.front().c_str(), std::move(items));
+        if (!checked->module) {
+            impala::Items items;
+            for (size_t i = 0, e = infiles.size(); i != e; ++i) {
+                checked->file_names.push_back(infiles[i]);
+                std::istringstream file(sources[i]);
+                impala::parse(items, file, checked->file_names.back().c_str(), &checked->included);
+            }
 
-        if (emit_ast)
-            module->stream(std::cout);
+            checked->module = std::make_unique<const impala::Module>(checked->file_names.front().c_str(), std::move(items));
+            checked->sources = sources;
+            checked->nossa = nossa;
+
+            if (emit_ast)
+                checked->module->stream(std::cout);
+        }
+
+        // the files read by include_bytes are only known after parsing
+        std::unique_ptr<impala::OutputCache> cache;
+        if (!cache_dir.empty() && impala::num_errors() == 0 && (emit_llvm || emit_cint) && !emit_thorin && !emit_ast && !emit_annotated) {
+            // the output depends on the code of the compiler and its libraries and, for the CPU backend, on the host
+            impala::Hasher hasher;
+            hasher << IMPALA_VERSION << impala::build_id();
+#ifdef LLVM_SUPPORT
+            hasher << llvm::sys::getDefaultTargetTriple() << llvm::sys::getHostCPUName().str();
+#endif
+            hasher << module_name << int64_t(opt) << opt_thorin << debug << nocleanup << nossa << no_bounds_checks << fast_math << emit_llvm << emit_cint;
+            for (size_t i = 0, e = infiles.size(); i != e; ++i)
+                hasher << infiles[i] << sources[i];
+            for (const auto& file : checked->included)
+                hasher << file.first << file.second;
+
+            cache = std::make_unique<impala::OutputCache>(cache_dir, hasher.hash());
+            if (cache->restore(module_name)) {
+                stats.cache = "hit";
+                if (print_stats)
+                    stats.print(std::cerr);
+                return EXIT_SUCCESS;
+            }
+            stats.cache = "miss";
+        }
+
+        if (!checked->typetable) {
+            Timer timer;
+            impala::check(checked->typetable, checked->module.get(), nossa);
+            stats.time("sema", timer.ms());
+
+            // diagnostics would not be repeated for a resident module
+            if (checked != &fresh && (impala::num_errors() != 0 || impala::num_warnings() != 0)) {
+                fresh = std::move(*checked);
+                resident_modules.pop_front();
+                checked = &fresh;
+            }
+        }
 
-        std::unique_ptr<impala::TypeTable> typetable;
-        impala::check(typetable, module.get(), nossa);
+        auto module = checked->module.get();
         bool result = impala::num_errors() == 0;
 
         if (emit_annotated)
@@ -206,43 +420,151 @@ int main(int argc, char** argv) {
                 thorin::errf("cannot open file '{}' for writing\n", opts.file_name);
                 return EXIT_FAILURE;
             }
-            impala::generate_c_interface(module.get(), opts, out_file);
+            impala::generate_c_interface(module, opts, out_file);
+            outputs.emplace_back(".h");
         }
 
-        if (result && (emit_llvm || emit_thorin))
-            impala::emit(world, module.get());
+#ifdef IMPALA_SERVER
+        // code generation modifies the AST - keep it out of the resident server
+        if (result && (emit_llvm || emit_thorin) && !impala::fork_worker())
+            return EXIT_SUCCESS;
+#endif
+
+        impala::LLVMAnnotations annotations;
+        if (result && (emit_llvm || emit_thorin)) {
+            Timer timer;
+            stats.skipped_items = impala::emit(world, module, annotations, !no_bounds_checks, fast_math);
+            stats.time("emit", timer.ms());
+            result = impala::num_errors() == 0;
+        }
 
         if (result) {
-            if (!nocleanup)
+            if (!nocleanup) {
+                Timer timer;
                 world.cleanup();
-            if (opt_thorin)
+                stats.time("cleanup", timer.ms());
+            }
+            if (opt_thorin) {
+                Timer timer;
                 world.opt();
+                stats.time("opt", timer.ms());
+            }
             if (emit_thorin)
                 world.dump();
             if (emit_llvm) {
 #ifdef LLVM_SUPPORT
                 thorin::Backends backends(world);
-                auto emit_to_file = [&](thorin::CodeGen* cg, std::string ext) {
-                    if (cg) {
-                        auto name = module_name + ext;
-                        std::ofstream file(name);
-                        if (!file)
-                            throw std::runtime_error("cannot write '" + name + "': " + strerror(errno));
-                        cg->emit(file, opt, debug);
-                    }
+
+                struct Job {
+                    thorin::CodeGen* cg;
+                    std::string ext;
+                    double begin = 0, end = 0; ///< Milliseconds since the first backend started.
+                };
+                std::vector<Job> jobs;
+                auto add_job = [&](thorin::CodeGen* cg, std::string ext) {
+                    if (cg)
+                        jobs.push_back({cg, ext});
                 };
-                emit_to_file(backends.cpu_cg.get(),    ".ll");
-                emit_to_file(backends.cuda_cg.get(),   ".cu");
-                emit_to_file(backends.nvvm_cg.get(),   ".nvvm");
-                emit_to_file(backends.opencl_cg.get(), ".cl");
-                emit_to_file(backends.amdgpu_cg.get(), ".amdgpu");
-                emit_to_file(backends.hls_cg.get(),    ".hls");
+                add_job(backends.cpu_cg.get(),    ".ll");
+                add_job(backends.cuda_cg.get(),   ".cu");
+                add_job(backends.nvvm_cg.get(),   ".nvvm");
+                add_job(backends.opencl_cg.get(), ".cl");
+                add_job(backends.amdgpu_cg.get(), ".amdgpu");
+                add_job(backends.hls_cg.get(),    ".hls");
+
+                Timer timer;
+                auto emit_to_file = [&](Job& job) {
+                    job.begin = timer.ms();
+                    auto name = module_name + job.ext;
+                    std::ofstream file(name);
+                    if (!file)
+                        throw std::runtime_error("cannot write '" + name + "': " + strerror(errno));
+                    if (job.ext == ".ll" || job.ext == ".nvvm" || job.ext == ".amdgpu") {
+                        // LLVM modules get what thorin can't express - the CPU one before LLVM optimizes it
+                        bool cpu = job.ext == ".ll";
+                        std::ostringstream ir;
+                        job.cg->emit(ir, cpu ? 0 : opt, debug);
+                        impala::finish_llvm(ir.str(), annotations, cpu ? opt : 0, file);
+                    } else
+                        job.cg->emit(file, opt, debug);
+                    file.close();
+                    if (!file)
+                        throw std::runtime_error("cannot write '" + name + "': " + strerror(errno));
+                    job.end = timer.ms();
+                };
+
+#ifdef IMPALA_FORK_BACKENDS
+                // the backends share the world and thorin's log, which are not thread-safe:
+                // emit them concurrently in forked processes which only report their times back
+                if (jobs.size() > 1) {
+                    std::cout.flush();
+                    std::cerr.flush();
+                    std::vector<std::pair<pid_t, int>> workers; // process and read end of its pipe
+                    for (auto& job : jobs) {
+                        int fds[2];
+                        if (pipe(fds) != 0)
+                            throw std::runtime_error(std::string("cannot create pipe: ") + strerror(errno));
+                        auto pid = fork();
+                        if (pid < 0)
+                            throw std::runtime_error(std::string("cannot fork backend: ") + strerror(errno));
+                        if (pid == 0) {
+                            close(fds[0]);
+                            int status = EXIT_SUCCESS;
+                            try {
+                                emit_to_file(job);
+                            } catch (std::exception const& e) {
+                                thorin::errf("{}\n", e.what());
+                                status = EXIT_FAILURE;
+                            }
+                            double times[2] = { job.begin, job.end };
+                            status = write(fds[1], times, sizeof(times)) == sizeof(times) ? status : EXIT_FAILURE;
+                            std::cout.flush();
+                            std::cerr.flush();
+                            _exit(status);
+                        }
+                        close(fds[1]);
+                        workers.emplace_back(pid, fds[0]);
+                    }
+
+                    std::string failed;
+                    for (size_t i = 0, e = jobs.size(); i != e; ++i) {
+                        double times[2] = { 0, 0 };
+                        ssize_t n;
+                        while ((n = read(workers[i].second, times, sizeof(times))) < 0 && errno == EINTR) {}
+                        close(workers[i].second);
+                        int status;
+                        while (waitpid(workers[i].first, &status, 0) < 0 && errno == EINTR) {}
+                        if (n != sizeof(times) || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+                            failed += " " + jobs[i].ext;
+                        jobs[i].begin = times[0];
+                        jobs[i].end = times[1];
+                    }
+                    if (!failed.empty())
+                        throw std::runtime_error("backend failed:" + failed);
+                } else
+#endif
+                for (auto& job : jobs)
+                    emit_to_file(job);
+                stats.backends_wall = timer.ms();
+
+                for (const auto& job : jobs) {
+                    outputs.push_back(job.ext);
+                    stats.time("backend " + job.ext, job.end - job.begin);
+                    stats.backends_summed += job.end - job.begin;
+                }
 #else
                 thorin::outf("warning: built without LLVM support - I don't emit an LLVM file\n");
 #endif
             }
-        } else
+        }
+
+        if (print_stats)
+            stats.print(std::cerr);
+        if (!result)
             return EXIT_FAILURE;
+        // diagnostics are not part of the entry - don't hide warnings on a later hit
+        if (cache && impala::num_warnings() == 0)
+            cache->store(module_name, outputs);
 
         return EXIT_SUCCESS;
     } catch (std::exception const& e) {
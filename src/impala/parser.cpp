@@ -1,5 +1,7 @@
 #include <algorithm>
+#include <fstream>
 #include <functional>
+#include <iterator>
 #include <sstream>
 
 #include "thorin/util/array.h"
@@ -65,10 +67,12 @@
     case Token::FOR: \
     case Token::WITH: \
     case Token::WHILE: \
+    case Token::HASH: \
     case Token::L_PAREN: \
     case Token::L_BRACE: \
     case Token::L_BRACKET: \
-    case Token::SIMD
+    case Token::SIMD: \
+    case Token::INCLUDE_BYTES
 
 #define STMT \
          Token::LET: \
@@ -97,7 +101,8 @@
     case Token::TILDE: \
     case Token::AND: \
     case Token::ANDAND: \
-    case Token::SIMD
+    case Token::SIMD: \
+    case Token::SLICE
 
 using namespace thorin;
 
@@ -107,8 +112,10 @@ class Parser;
 
 class Parser {
 public:
-    Parser(std::istream& stream, const char* filename)
+    Parser(std::istream& stream, const char* filename, IncludedFiles* included)
         : lexer_(stream, filename)
+        , filename_(filename)
+        , included_(included)
         , cur_var_handle(2) // reserve 1 for conditionals, 0 for mem
     {
         lookahead_[0] = lexer_.lex();
@@ -179,7 +186,8 @@ public:
     const Identifier* try_identifier(const std::string& what);
     Visibility parse_visibility();
     uint64_t parse_integer(const char* what);
-    int parse_addr_space();
+    void parse_ptr_annotation(int& addr_space, int& align);
+    Attrs parse_attrs();
     char char_value(const char*& p);
 
     // paths
@@ -208,22 +216,25 @@ public:
     const PtrASTType*   parse_ptr_type();
     const TupleASTType* parse_tuple_type();
     const SimdASTType*  parse_simd_type();
+    const SliceASTType* parse_slice_type();
     const ASTTypeApp*   parse_ast_type_app();
+    const ASTType*      parse_type_arg();
+    const ASTType*      parse_dim(const char* what);
 
     enum class BodyMode { None, Optional, Mandatory };
 
     // items + helpers
-    const Item*        parse_item();
+    const Item*        parse_item(Attrs&& attrs = Attrs());
     void               parse_items(Items&);
     const StaticItem*  parse_static_item(Tracker, Visibility);
     const EnumDecl*    parse_enum_decl(Tracker, Visibility);
     const OptionDecl*  parse_option_decl(const size_t);
-    const FnDecl*      parse_fn_decl(BodyMode, Tracker, Visibility, bool is_extern, Symbol abi);
+    const FnDecl*      parse_fn_decl(BodyMode, Tracker, Visibility, bool is_extern, Symbol abi, Attrs&& attrs = Attrs());
     const ImplItem*    parse_impl(Tracker, Visibility);
     const Item*        parse_module_or_module_decl(Tracker, Visibility);
     const Module*      parse_module();
-    const Item*        parse_extern_block_or_fn_decl(Tracker, Visibility);
-    const StructDecl*  parse_struct_decl(Tracker, Visibility);
+    const Item*        parse_extern_block_or_fn_decl(Tracker, Visibility, Attrs&& attrs = Attrs());
+    const StructDecl*  parse_struct_decl(Tracker, Visibility, Attrs&& = Attrs());
     const FieldDecl*   parse_field_decl(const size_t i);
     const TraitDecl*   parse_trait_decl(Tracker, Visibility);
     const Typedef*     parse_typedef(Tracker, Visibility);
@@ -234,28 +245,31 @@ public:
     const Expr*         parse_prefix_expr();
     const Expr*         parse_infix_expr(Tracker, const Expr* lhs);
     const Expr*         parse_postfix_expr(Tracker, const Expr* lhs);
-    const MapExpr*      parse_map_expr(Tracker, const Expr* lhs);
+    const Expr*         parse_map_expr(Tracker, const Expr* lhs);
     const TypeAppExpr*  parse_type_app_expr(Tracker, const Expr* lhs);
     const Expr*         parse_primary_expr();
     const LiteralExpr*  parse_literal_expr();
     const CharExpr*     parse_char_expr();
     const StrExpr*      parse_str_expr();
-    const FnExpr*       parse_fn_expr(bool nested = false);
+    const IncludeBytesExpr* parse_include_bytes_expr();
+    const FnExpr*       parse_fn_expr(bool nested = false, Attrs&& attrs = Attrs());
     const IfExpr*       parse_if_expr();
     const MatchExpr*    parse_match_expr();
-    const ForExpr*      parse_for_expr();
+    const ForExpr*      parse_for_expr(Attrs&& attrs = Attrs());
     const ForExpr*      parse_with_expr();
-    const WhileExpr*    parse_while_expr();
-    const BlockExpr*    parse_block_expr();
+    const WhileExpr*    parse_while_expr(Attrs&& attrs = Attrs());
+    const Expr*         parse_attributed_expr(Attrs&& attrs);
+    const BlockExpr*    parse_block_expr(Attrs&& = Attrs());
     const BlockExpr*    try_block_expr(const std::string& context);
     const Expr*         parse_pe_expr(const char* context);
 
     // patterns
     const Ptrn*        parse_ptrn();
+    const Ptrn*        parse_primary_ptrn();
     const TuplePtrn*   parse_tuple_ptrn();
     const IdPtrn*      parse_id_ptrn(const Identifier*);
     const EnumPtrn*    parse_enum_ptrn(const Path*);
-    const LiteralPtrn* parse_literal_ptrn();
+    const Ptrn*        parse_literal_ptrn();
 
     // statements
     const ItemStmt* parse_item_stmt();
@@ -278,14 +292,16 @@ private:
 
     Lexer lexer_;        ///< invoked in order to get next token
     Token lookahead_[3]; ///< SLL(3) look ahead
+    std::string filename_;
+    IncludedFiles* included_; ///< records the files read by include_bytes expressions if not null
     size_t cur_var_handle;
     Location prev_location_;
 };
 
 //------------------------------------------------------------------------------
 
-void parse(Items& items, std::istream& is, const char* filename) {
-    Parser parser(is, filename);
+void parse(Items& items, std::istream& is, const char* filename, IncludedFiles* included) {
+    Parser parser(is, filename, included);
     parser.parse_items(items);
     if (parser.lookahead() != Token::Eof)
         parser.error("module item", "module contents");
@@ -365,14 +381,51 @@ uint64_t Parser::parse_integer(const char* what) {
     }
 }
 
-int Parser::parse_addr_space() {
-    if (lookahead(0) == Token::L_BRACKET && lookahead(1) == Token::LIT_i32) {
+void Parser::parse_ptr_annotation(int& addr_space, int& align) {
+    // [addr_space], [align N] or [addr_space, align N]
+    addr_space = 0;
+    align = 0;
+    if (lookahead(0) == Token::L_BRACKET
+            && (lookahead(1) == Token::LIT_i32
+                || (lookahead(1) == Token::ID && lookahead(1).symbol() == "align" && lookahead(2) == Token::LIT_i32))) {
         eat(Token::L_BRACKET);
-        int addr_space = parse_integer("address space");
-        expect(Token::R_BRACKET, "address space annotation");
-        return addr_space;
+        if (lookahead() == Token::LIT_i32) {
+            addr_space = parse_integer("address space");
+            if (!accept(Token::COMMA)) {
+                expect(Token::R_BRACKET, "address space annotation");
+                return;
+            }
+        }
+        if (lookahead() == Token::ID && lookahead().symbol() == "align")
+            lex();
+        else
+            error("'align'", "pointer annotation");
+        align = parse_integer("alignment");
+        expect(Token::R_BRACKET, "pointer annotation");
+    }
+}
+
+Attrs Parser::parse_attrs() {
+    Attrs attrs;
+    while (accept(Token::HASH)) {
+        expect(Token::L_BRACKET, "attribute");
+        parse_comma_list("attribute", Token::R_BRACKET, [&] {
+            auto tracker = track();
+            std::unique_ptr<const Identifier> id(try_identifier("attribute"));
+            std::vector<uint64_t> args;
+            Strings strs;
+            if (accept(Token::L_PAREN)) {
+                parse_comma_list("arguments of an attribute", Token::R_PAREN, [&] {
+                    if (lookahead() == Token::LIT_str)
+                        strs.emplace_back(lex().symbol().remove_quotation());
+                    else
+                        args.push_back(parse_integer("attribute argument"));
+                });
+            }
+            attrs.emplace_back(new Attr(tracker, id->symbol(), std::move(args), std::move(strs)));
+        });
     }
-    return 0;
+    return attrs;
 }
 
 /*
@@ -408,13 +461,18 @@ const ASTTypeParam* Parser::parse_ast_type_param() {
     auto tracker = track();
     auto identifier = try_identifier("type parameter");
     ASTTypes bounds;
+    bool is_const = false;
     if (accept(Token::COLON)) {
-        do {
-            bounds.emplace_back(parse_type());
-        } while (accept(Token::ADD));
+        if (accept(Token::CONST))
+            is_const = true;
+        else {
+            do {
+                bounds.emplace_back(parse_type());
+            } while (accept(Token::ADD));
+        }
     }
 
-    return new ASTTypeParam(tracker, identifier, std::move(bounds));
+    return new ASTTypeParam(tracker, identifier, std::move(bounds), is_const);
 }
 
 Params Parser::parse_param_list(TokenTag delimiter, bool lambda) {
@@ -433,6 +491,13 @@ const Param* Parser::parse_param(int /*i*/, bool lambda) {
     } else
         pe_expr = parse_pe_expr("partial evaluation profile of function parameter");
 
+    // noalias is only a keyword in front of a parameter name
+    bool noalias = false;
+    if (lookahead() == Token::ID && lookahead().symbol() == "noalias" && (lookahead(1) == Token::ID || lookahead(1) == Token::MUT)) {
+        lex();
+        noalias = true;
+    }
+
     bool mut = accept(Token::MUT);
     const Identifier* identifier = nullptr;
     const ASTType* type = nullptr;
@@ -477,7 +542,7 @@ const Param* Parser::parse_param(int /*i*/, bool lambda) {
         pe_expr = new PrefixExpr(tracker, PrefixExpr::Tag::KNOWN, id);
     }
 
-    return new Param(tracker, cur_var_handle++, mut, identifier, ast_type, pe_expr);
+    return new Param(tracker, cur_var_handle++, mut, identifier, ast_type, pe_expr, noalias);
 }
 
 const Param* Parser::parse_return_param() {
@@ -495,18 +560,21 @@ const Param* Parser::parse_return_param() {
  * items
  */
 
-const Item* Parser::parse_item() {
+const Item* Parser::parse_item(Attrs&& attrs) {
     auto tracker = track();
     auto vis = parse_visibility();
 
+    if (!attrs.empty() && lookahead() != Token::FN && lookahead() != Token::EXTERN && lookahead() != Token::STRUCT)
+        error("function or struct declaration", "attributed item");
+
     switch (lookahead()) {
         case Token::ENUM:    return parse_enum_decl(tracker, vis);
-        case Token::EXTERN:  return parse_extern_block_or_fn_decl(tracker, vis);
-        case Token::FN:      return parse_fn_decl(BodyMode::Mandatory, tracker, vis, /*extern*/ false, /*abi*/ "");
+        case Token::EXTERN:  return parse_extern_block_or_fn_decl(tracker, vis, std::move(attrs));
+        case Token::FN:      return parse_fn_decl(BodyMode::Mandatory, tracker, vis, /*extern*/ false, /*abi*/ "", std::move(attrs));
         case Token::IMPL:    return parse_impl(tracker, vis);
         case Token::MOD:     return parse_module_or_module_decl(tracker, vis);
         case Token::STATIC:  return parse_static_item(tracker, vis);
-        case Token::STRUCT:  return parse_struct_decl(tracker, vis);
+        case Token::STRUCT:  return parse_struct_decl(tracker, vis, std::move(attrs));
         case Token::TRAIT:   return parse_trait_decl(tracker, vis);
         case Token::TYPEDEF: return parse_typedef(tracker, vis);
         default: THORIN_UNREACHABLE;
@@ -539,10 +607,14 @@ const OptionDecl* Parser::parse_option_decl(const size_t i) {
     return new OptionDecl(tracker, i, identifier, std::move(args));
 }
 
-const Item* Parser::parse_extern_block_or_fn_decl(Tracker tracker, Visibility vis) {
+const Item* Parser::parse_extern_block_or_fn_decl(Tracker tracker, Visibility vis, Attrs&& attrs) {
     eat(Token::EXTERN);
     if (lookahead() == Token::FN)
-        return parse_fn_decl(BodyMode::Mandatory, tracker, vis, /*extern*/ true, /*abi*/ "");
+        return parse_fn_decl(BodyMode::Mandatory, tracker, vis, /*extern*/ true, /*abi*/ "", std::move(attrs));
+
+    // attributes belong to the functions of the block
+    if (!attrs.empty())
+        error("function declaration", "attributed item");
 
     Symbol abi;
     if (lookahead() == Token::LIT_str)
@@ -550,14 +622,16 @@ const Item* Parser::parse_extern_block_or_fn_decl(Tracker tracker, Visibility vi
 
     expect(Token::L_BRACE, "opening brace of external block");
     FnDecls fn_decls;
-    while (lookahead() == Token::FN)
-        fn_decls.emplace_back(parse_fn_decl(BodyMode::None, tracker, vis, /*extern*/ true, abi));
+    while (lookahead() == Token::FN || lookahead() == Token::HASH) {
+        auto fn_attrs = parse_attrs();
+        fn_decls.emplace_back(parse_fn_decl(BodyMode::None, tracker, vis, /*extern*/ true, abi, std::move(fn_attrs)));
+    }
     expect(Token::R_BRACE, "closing brace of external block");
 
     return new ExternBlock(tracker, vis, abi, std::move(fn_decls));
 }
 
-const FnDecl* Parser::parse_fn_decl(BodyMode mode, Tracker tracker, Visibility vis, bool is_extern, Symbol abi) {
+const FnDecl* Parser::parse_fn_decl(BodyMode mode, Tracker tracker, Visibility vis, bool is_extern, Symbol abi, Attrs&& attrs) {
     //THORIN_PUSH(cur_var_handle, cur_var_handle);
 
     eat(Token::FN);
@@ -582,7 +656,7 @@ const FnDecl* Parser::parse_fn_decl(BodyMode mode, Tracker tracker, Visibility v
     }
 
     return new FnDecl(tracker, vis, is_extern, abi, pe_expr, export_name, identifier,
-                      std::move(ast_type_params), std::move(params), body);
+                      std::move(ast_type_params), std::move(params), body, std::move(attrs));
 }
 
 const ImplItem* Parser::parse_impl(Tracker tracker, Visibility vis) {
@@ -628,6 +702,18 @@ void Parser::parse_items(Items& items) {
             case ITEM:
                 items.emplace_back(parse_item());
                 continue;
+            case Token::HASH: {
+                auto attrs = parse_attrs();
+                switch (lookahead()) {
+                    case VISIBILITY:
+                    case ITEM:
+                        items.emplace_back(parse_item(std::move(attrs)));
+                        break;
+                    default:
+                        error("item", "attributed item");
+                }
+                continue;
+            }
             case Token::SEMICOLON:
                 lex();
                 continue;
@@ -647,7 +733,7 @@ const StaticItem* Parser::parse_static_item(Tracker tracker, Visibility vis) {
     return new StaticItem(tracker, vis, mut, identifier, ast_type, init);
 }
 
-const StructDecl* Parser::parse_struct_decl(Tracker tracker, Visibility vis) {
+const StructDecl* Parser::parse_struct_decl(Tracker tracker, Visibility vis, Attrs&& attrs) {
     eat(Token::STRUCT);
     auto identifier = try_identifier("struct declaration");
     auto ast_type_params = parse_ast_type_params();
@@ -657,16 +743,17 @@ const StructDecl* Parser::parse_struct_decl(Tracker tracker, Visibility vis) {
     parse_comma_list("closing brace of struct declaration", Token::R_BRACE, [&] {
         field_decls.emplace_back(parse_field_decl(i++));
     });
-    return new StructDecl(tracker, vis, identifier, std::move(ast_type_params), std::move(field_decls));
+    return new StructDecl(tracker, vis, identifier, std::move(ast_type_params), std::move(field_decls), std::move(attrs));
 }
 
 const FieldDecl* Parser::parse_field_decl(const size_t i) {
     auto tracker = track();
+    auto attrs = parse_attrs();
     auto vis = parse_visibility();
     auto identifier = try_identifier("struct field");
     expect(Token::COLON, "struct field");
     auto ast_type = parse_type();
-    return new FieldDecl(tracker, i, vis, identifier, ast_type);
+    return new FieldDecl(tracker, i, vis, identifier, ast_type, std::move(attrs));
 }
 
 const TraitDecl* Parser::parse_trait_decl(Tracker tracker, Visibility vis) {
@@ -719,6 +806,7 @@ const ASTType* Parser::parse_type() {
         case Token::AND:
         case Token::ANDAND:     return parse_ptr_type();
         case Token::SIMD:       return parse_simd_type();
+        case Token::SLICE:      return parse_slice_type();
         default:  {
             error("type", "");
             return create<ErrorASTType>();
@@ -731,7 +819,7 @@ const ArrayASTType* Parser::parse_array_type() {
     eat(Token::L_BRACKET);
     auto elem_ast_type = parse_type();
     if (accept(Token::MUL)) {
-        auto dim = parse_integer("definite array type");
+        auto dim = parse_dim("definite array type");
         expect(Token::R_BRACKET, "definite array type");
         return new DefiniteArrayASTType(tracker, elem_ast_type, dim);
     }
@@ -790,9 +878,10 @@ const PtrASTType* Parser::parse_ptr_type() {
     auto tracker = track();
     if (accept(Token::ANDAND)) {
         auto tag = accept(Token::MUT) ? PtrASTType::Mut : PtrASTType::Borrowed;
-        auto addr_space = parse_addr_space();
+        int addr_space, align;
+        parse_ptr_annotation(addr_space, align);
         auto referenced_ast_type = parse_type();
-        return new PtrASTType(tracker, PtrASTType::Borrowed, 0, new PtrASTType(tracker, tag, addr_space, referenced_ast_type));
+        return new PtrASTType(tracker, PtrASTType::Borrowed, 0, 0, new PtrASTType(tracker, tag, addr_space, align, referenced_ast_type));
     }
 
     PtrASTType::Tag tag;
@@ -806,9 +895,10 @@ const PtrASTType* Parser::parse_ptr_type() {
             tag = PtrASTType::Borrowed;
     }
 
-    auto addr_space = parse_addr_space();
+    int addr_space, align;
+    parse_ptr_annotation(addr_space, align);
     auto referenced_ast_type = parse_type();
-    return new PtrASTType(tracker, tag, addr_space, referenced_ast_type);
+    return new PtrASTType(tracker, tag, addr_space, align, referenced_ast_type);
 }
 
 const TupleASTType* Parser::parse_tuple_type() {
@@ -828,13 +918,33 @@ const ASTTypeApp* Parser::parse_ast_type_app() {
     ASTTypes ast_type_args;
     if (accept(Token::L_BRACKET)) {
         parse_comma_list("type arguments for type application", Token::R_BRACKET, [&] {
-            ast_type_args.emplace_back(parse_type());
+            ast_type_args.emplace_back(parse_type_arg());
         });
     }
 
     return new ASTTypeApp(tracker, path, std::move(ast_type_args));
 }
 
+/// Type or integer literal as argument of a const type parameter.
+const ASTType* Parser::parse_type_arg() {
+    switch (lookahead()) {
+        case Token::LIT_i8:  case Token::LIT_i16: case Token::LIT_i32: case Token::LIT_i64:
+        case Token::LIT_u8:  case Token::LIT_u16: case Token::LIT_u32: case Token::LIT_u64:
+            return parse_dim("type argument");
+        default:
+            return parse_type();
+    }
+}
+
+/// Integer literal or const type parameter as dimension of an array or simd type.
+const ASTType* Parser::parse_dim(const char* what) {
+    if (lookahead() == Token::ID)
+        return parse_ast_type_app();
+    auto tracker = track();
+    auto value = parse_integer(what);
+    return new ConstASTType(tracker, value);
+}
+
 const Typeof* Parser::parse_typeof() {
     auto tracker = track();
     eat(Token::TYPEOF);
@@ -850,11 +960,27 @@ const SimdASTType* Parser::parse_simd_type() {
     expect(Token::L_BRACKET, "simd type");
     auto elem_ast_type = parse_type();
     expect(Token::MUL, "simd type");
-    auto size = parse_integer("simd vector size");
+    auto size = parse_dim("simd vector size");
     expect(Token::R_BRACKET, "simd type");
     return new SimdASTType(tracker, elem_ast_type, size);
 }
 
+const SliceASTType* Parser::parse_slice_type() {
+    auto tracker = track();
+    eat(Token::SLICE);
+    expect(Token::L_BRACKET, "slice type");
+    bool mut = accept(Token::MUT);
+    int addr_space = 0;
+    if (lookahead(0) == Token::L_BRACKET && lookahead(1) == Token::LIT_i32) {
+        eat(Token::L_BRACKET);
+        addr_space = parse_integer("address space");
+        expect(Token::R_BRACKET, "address space annotation");
+    }
+    auto elem_ast_type = parse_type();
+    expect(Token::R_BRACKET, "slice type");
+    return new SliceASTType(tracker, mut, addr_space, elem_ast_type);
+}
+
 /*
  * expressions
  */
@@ -912,17 +1038,32 @@ const Expr* Parser::parse_infix_expr(Tracker tracker, const Expr* lhs) {
     return new InfixExpr(tracker, lhs, (InfixExpr::Tag) tag, rhs);
 }
 
-const MapExpr* Parser::parse_map_expr(Tracker tracker, const Expr* lhs) {
+const Expr* Parser::parse_map_expr(Tracker tracker, const Expr* lhs) {
     eat(Token::L_PAREN);
     Exprs args;
-    parse_comma_list("arguments of a map expression", Token::R_PAREN, [&] { args.emplace_back(parse_expr()); });
+    bool slice = false;
+    parse_comma_list("arguments of a map expression", Token::R_PAREN, [&] {
+        args.emplace_back(parse_expr());
+        if (args.size() == 1 && accept(Token::DOTDOT)) {
+            args.emplace_back(parse_expr());
+            slice = true;
+        }
+    });
+
+    if (slice && args.size() == 2) {
+        auto begin = args[0].release();
+        auto end = args[1].release();
+        return new SliceExpr(tracker, lhs, begin, end);
+    }
+    if (slice)
+        impala::error(lhs, "expected single range in slice expression");
     return new MapExpr(tracker, lhs, std::move(args));
 }
 
 const TypeAppExpr* Parser::parse_type_app_expr(Tracker tracker, const Expr* lhs) {
     eat(Token::L_BRACKET);
     ASTTypes ast_type_args;
-    parse_comma_list("type arguments of a map expression", Token::R_BRACKET, [&] { ast_type_args.emplace_back(parse_type()); });
+    parse_comma_list("type arguments of a map expression", Token::R_BRACKET, [&] { ast_type_args.emplace_back(parse_type_arg()); });
     return new TypeAppExpr(tracker, lhs, std::move(ast_type_args));
 }
 
@@ -971,7 +1112,7 @@ const Expr* Parser::parse_primary_expr() {
             }
 
             if (accept(Token::COMMA) && accept(Token::DOTDOT)) {
-                auto count = parse_integer("repeated array expression");
+                auto count = parse_dim("repeated array expression");
                 expect(Token::R_BRACKET, "repeated array expression");
                 return new RepeatedDefiniteArrayExpr(tracker, expr, count);
             }
@@ -988,6 +1129,7 @@ const Expr* Parser::parse_primary_expr() {
             parse_comma_list("elements of a simd expression", Token::R_BRACKET, [&] { args.emplace_back(parse_expr()); });
             return new SimdExpr(tracker, std::move(args));
         }
+        case Token::INCLUDE_BYTES: return parse_include_bytes_expr();
 #define IMPALA_LIT(itype, atype) \
         case Token::LIT_##itype:
 #include "impala/tokenlist.h"
@@ -1000,7 +1142,7 @@ const Expr* Parser::parse_primary_expr() {
             auto path = parse_path();
             ASTTypes ast_type_args;
             if (accept(Token::L_BRACKET)) {     // struct or map expression
-                parse_comma_list("type arguments", Token::R_BRACKET, [&] { ast_type_args.emplace_back(parse_type()); });
+                parse_comma_list("type arguments", Token::R_BRACKET, [&] { ast_type_args.emplace_back(parse_type_arg()); });
 
                 if (accept(Token::L_PAREN)) {   // type app expression + map expression
                     auto type_app_expr = new TypeAppExpr(tracker, new PathExpr(path), std::move(ast_type_args));
@@ -1034,6 +1176,7 @@ const Expr* Parser::parse_primary_expr() {
         case Token::FOR:        return parse_for_expr();
         case Token::WITH:       return parse_with_expr();
         case Token::WHILE:      return parse_while_expr();
+        case Token::HASH:       return parse_attributed_expr(parse_attrs());
         case Token::L_BRACE:    return parse_block_expr();
         default:                error("expression", ""); return new EmptyExpr(lex().location());
     }
@@ -1116,7 +1259,43 @@ const StrExpr* Parser::parse_str_expr() {
     return new StrExpr(tracker, std::move(symbols), std::move(values));
 }
 
-const FnExpr* Parser::parse_fn_expr(bool nested) {
+const IncludeBytesExpr* Parser::parse_include_bytes_expr() {
+    auto tracker = track();
+    eat(Token::INCLUDE_BYTES);
+    const ASTType* elem_ast_type = nullptr;
+    if (accept(Token::L_BRACKET)) {
+        elem_ast_type = parse_type();
+        expect(Token::R_BRACKET, "element type of include_bytes expression");
+    }
+    expect(Token::L_PAREN, "include_bytes expression");
+
+    std::string path;
+    if (lookahead() == Token::LIT_str) {
+        std::unique_ptr<const StrExpr> str(parse_str_expr());
+        path.assign(str->values().data(), str->values().size() - 1);
+    } else
+        error("string literal", "path of include_bytes expression");
+    expect(Token::R_PAREN, "include_bytes expression");
+
+    // relative paths start at the directory of the including file
+    auto file = path;
+    if (!path.empty() && path.front() != '/') {
+        auto slash = filename_.rfind('/');
+        if (slash != std::string::npos)
+            file = filename_.substr(0, slash + 1) + path;
+    }
+
+    std::ifstream is(file, std::ios::binary);
+    if (!is)
+        impala::error(prev_location(), "cannot read file '{}' in include_bytes expression", file);
+    std::string bytes((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    if (included_)
+        included_->emplace_back(file, bytes);
+
+    return new IncludeBytesExpr(tracker, elem_ast_type, std::move(path), std::move(bytes));
+}
+
+const FnExpr* Parser::parse_fn_expr(bool nested, Attrs&& attrs) {
     //THORIN_PUSH(cur_var_handle, cur_var_handle);
     auto tracker = track();
 
@@ -1148,7 +1327,7 @@ const FnExpr* Parser::parse_fn_expr(bool nested) {
 
     auto body = parse_expr();
 
-    return new FnExpr(tracker, pe_expr, std::move(params), body);
+    return new FnExpr(tracker, pe_expr, std::move(params), body, std::move(attrs));
 }
 
 const IfExpr* Parser::parse_if_expr() {
@@ -1187,7 +1366,21 @@ const MatchExpr* Parser::parse_match_expr() {
     return new MatchExpr(tracker, expr, std::move(arms));
 }
 
-const ForExpr* Parser::parse_for_expr() {
+const Expr* Parser::parse_attributed_expr(Attrs&& attrs) {
+    switch (lookahead()) {
+        case Token::FOR:   return parse_for_expr(std::move(attrs));
+        case Token::WHILE: return parse_while_expr(std::move(attrs));
+        case Token::OR:
+        case Token::OROR:
+        case Token::RUN:   return parse_fn_expr(false, std::move(attrs));
+        case Token::L_BRACE: return parse_block_expr(std::move(attrs));
+        default:
+            error("loop, block or function expression", "attributed expression");
+            return parse_expr();
+    }
+}
+
+const ForExpr* Parser::parse_for_expr(Attrs&& attrs) {
     //THORIN_PUSH(cur_var_handle, cur_var_handle);
     auto tracker = track();
     eat(Token::FOR);
@@ -1197,7 +1390,7 @@ const ForExpr* Parser::parse_for_expr() {
     auto pe_expr = parse_pe_expr("partial evaluation profile of for loop");
     auto body = try_block_expr("body of for loop");
     auto break_decl = create_continuation_decl("break", /*set type during InferSema*/ false);
-    return new ForExpr(tracker, new FnExpr(tracker, pe_expr, std::move(params), body), expr, break_decl);
+    return new ForExpr(tracker, new FnExpr(tracker, pe_expr, std::move(params), body), expr, break_decl, std::move(attrs));
 }
 
 const ForExpr* Parser::parse_with_expr() {
@@ -1215,17 +1408,17 @@ const ForExpr* Parser::parse_with_expr() {
     return new ForExpr(tracker, new FnExpr(tracker, pe_expr, std::move(params), body), expr, break_decl);
 }
 
-const WhileExpr* Parser::parse_while_expr() {
+const WhileExpr* Parser::parse_while_expr(Attrs&& attrs) {
     auto tracker = track();
     eat(Token::WHILE);
     auto continue_decl = create_continuation_decl("continue", true);
     auto cond = parse_expr();
     auto body = try_block_expr("body of while loop");
     auto break_decl = create_continuation_decl("break", true);
-    return new WhileExpr(tracker, continue_decl, cond, body, break_decl);
+    return new WhileExpr(tracker, continue_decl, cond, body, break_decl, std::move(attrs));
 }
 
-const BlockExpr* Parser::parse_block_expr() {
+const BlockExpr* Parser::parse_block_expr(Attrs&& attrs) {
     auto tracker = track();
     eat(Token::L_BRACE);
     Stmts stmts;
@@ -1246,6 +1439,18 @@ const BlockExpr* Parser::parse_block_expr() {
                     case Token::FOR:        expr = parse_for_expr(); break;
                     case Token::WITH:       expr = parse_with_expr(); break;
                     case Token::WHILE:      expr = parse_while_expr(); break;
+                    case Token::HASH: {
+                        auto attrs = parse_attrs();
+                        switch (lookahead()) {
+                            case VISIBILITY:
+                            case ITEM:
+                                stmts.emplace_back(new ItemStmt(tracker, parse_item(std::move(attrs))));
+                                continue;
+                            default:
+                                expr = parse_attributed_expr(std::move(attrs));
+                        }
+                        break;
+                    }
                     case Token::L_BRACE:    expr = parse_block_expr(); break;
                     default:                expr = parse_expr(); stmt_like = false;
                 }
@@ -1262,7 +1467,7 @@ const BlockExpr* Parser::parse_block_expr() {
                 expect(Token::R_BRACE, "block expression");
                 if (final_expr == nullptr)
                     final_expr = create<EmptyExpr>();
-                return new BlockExpr(tracker, std::move(stmts), final_expr);
+                return new BlockExpr(tracker, std::move(stmts), final_expr, std::move(attrs));
         }
     }
 }
@@ -1298,6 +1503,19 @@ const Expr* Parser::parse_pe_expr(const char* context) {
  */
 
 const Ptrn* Parser::parse_ptrn() {
+    auto tracker = track();
+    auto ptrn = parse_primary_ptrn();
+    if (lookahead() != Token::OR)
+        return ptrn;
+
+    Ptrns alts;
+    alts.emplace_back(ptrn);
+    while (accept(Token::OR))
+        alts.emplace_back(parse_primary_ptrn());
+    return new OrPtrn(tracker, std::move(alts));
+}
+
+const Ptrn* Parser::parse_primary_ptrn() {
     switch (lookahead()) {
         case Token::SUB:
         case Token::TRUE:
@@ -1351,9 +1569,16 @@ const EnumPtrn* Parser::parse_enum_ptrn(const Path* path) {
     return new EnumPtrn(tracker, path, std::move(args));
 }
 
-const LiteralPtrn* Parser::parse_literal_ptrn() {
+const Ptrn* Parser::parse_literal_ptrn() {
+    auto tracker = track();
     bool minus = accept(Token::SUB);
-    return new LiteralPtrn(parse_literal_expr(), minus);
+    auto lo = new LiteralPtrn(parse_literal_expr(), minus);
+    if (!accept(Token::DOTDOT))
+        return lo;
+
+    minus = accept(Token::SUB);
+    auto hi = new LiteralPtrn(parse_literal_expr(), minus);
+    return new RangePtrn(tracker, lo, hi);
 }
 
 /*
@@ -256,13 +256,18 @@ const Type* InferSema::unify(const Type* dst, const Type* src) {
                 if (src_owned_ptr_type->addr_space() == dst_borrowed_ptr_type->addr_space())
                     return borrowed_ptr_type(unify(dst->op(0), src->op(0)),
                                              dst_borrowed_ptr_type->is_mut(),
-                                             dst_borrowed_ptr_type->addr_space());
+                                             dst_borrowed_ptr_type->addr_space(),
+                                             dst_borrowed_ptr_type->align());
             }
         }
 
         if (dst->isa<IndefiniteArrayType>() && src->isa<DefiniteArrayType>())
             return indefinite_array_type(unify(dst->op(0), src->op(0)));
 
+        // different integers - dst == src was handled above
+        if (dst->isa<ConstType>() && src->isa<ConstType>())
+            return infer_error(dst, src);
+
         if (dst->tag() == src->tag()) {
             // Handle nominal types
             if (src->is_nominal() && src != dst)
@@ -416,16 +421,18 @@ const Type* PrimASTType::infer(InferSema& sema) const {
 const Type* PtrASTType::infer(InferSema& sema) const {
     auto pointee = sema.infer(referenced_ast_type());
     switch (tag()) {
-        case Borrowed: return sema.borrowed_ptr_type(pointee, false, addr_space());
-        case Mut:      return sema.borrowed_ptr_type(pointee,  true, addr_space());
-        case Owned:    return sema.   owned_ptr_type(pointee, addr_space());
+        case Borrowed: return sema.borrowed_ptr_type(pointee, false, addr_space(), align());
+        case Mut:      return sema.borrowed_ptr_type(pointee,  true, addr_space(), align());
+        case Owned:    return sema.   owned_ptr_type(pointee, addr_space(), align());
     }
     THORIN_UNREACHABLE;
 }
 
 const Type* IndefiniteArrayASTType::infer(InferSema& sema) const { return sema.indefinite_array_type(sema.infer(elem_ast_type())); }
-const Type* DefiniteArrayASTType::infer(InferSema& sema) const { return sema.definite_array_type(sema.infer(elem_ast_type()), dim()); }
-const Type* SimdASTType::infer(InferSema& sema) const { return sema.simd_type(sema.infer(elem_ast_type()), size()); }
+const Type* DefiniteArrayASTType::infer(InferSema& sema) const { return sema.definite_array_type(sema.infer(elem_ast_type()), sema.infer(dim())); }
+const Type* SimdASTType::infer(InferSema& sema) const { return sema.simd_type(sema.infer(elem_ast_type()), sema.infer(size())); }
+const Type* SliceASTType::infer(InferSema& sema) const { return sema.slice_type(sema.infer(elem_ast_type()), is_mut(), addr_space()); }
+const Type* ConstASTType::infer(InferSema& sema) const { return sema.const_type(value()); }
 
 const Type* TupleASTType::infer(InferSema& sema) const {
     Array<const Type*> types(num_ast_type_args());
@@ -709,7 +716,7 @@ const Type* InfixExpr::infer(InferSema& sema) const {
             sema.constrain(lhs(), rtype);
             sema.constrain(rhs(), ltype);
             if (auto simd = rhs()->type()->isa<SimdType>())
-                return sema.simd_type(sema.type_bool(), simd->dim());
+                return sema.simd_type(sema.type_bool(), simd->dim_type());
             return sema.type_bool();
         }
         case OROR:
@@ -811,7 +818,7 @@ const Type* SimdExpr::infer(InferSema& sema) const {
 }
 
 const Type* RepeatedDefiniteArrayExpr::infer(InferSema& sema) const {
-    return sema.definite_array_type(sema.rvalue(value()), count());
+    return sema.definite_array_type(sema.rvalue(value()), sema.infer(count()));
 }
 
 const Type* IndefiniteArrayExpr::infer(InferSema& sema) const {
@@ -819,6 +826,14 @@ const Type* IndefiniteArrayExpr::infer(InferSema& sema) const {
     return sema.indefinite_array_type(sema.infer(elem_ast_type()));
 }
 
+const Type* IncludeBytesExpr::infer(InferSema& sema) const {
+    auto elem_type = elem_ast_type() ? sema.infer(elem_ast_type()) : sema.type_u8();
+    auto size = bytes().size();
+    if (auto prim_type = elem_type->isa<PrimType>())
+        size /= num_bytes(prim_type->primtype_tag());
+    return sema.definite_array_type(elem_type, size);
+}
+
 const Type* TupleExpr::infer(InferSema& sema) const {
     Array<const Type*> types(num_args());
     for (size_t i = 0, e = types.size(); i != e; ++i)
@@ -885,6 +900,10 @@ const Type* FieldExpr::infer(InferSema& sema) const {
         }
     }
 
+    // the length of a slice is read-only
+    if (ltype->isa<SliceType>() && symbol() == "len")
+        return sema.type_i64();
+
     return ltype->is_known() ? sema.type_error() : sema.find_type(this);
 }
 
@@ -933,6 +952,10 @@ const Type* MapExpr::infer(InferSema& sema) const {
     if (auto array = ltype->isa<ArrayType>())
         return sema.wrap_ref(ref, array->elem_type());
 
+    // elements of a slice are always accessed through its pointer
+    if (auto slice_type = ltype->isa<SliceType>())
+        return sema.ref_type(slice_type->elem_type(), slice_type->is_mut(), slice_type->addr_space());
+
     if (auto tuple_type = ltype->isa<TupleType>()) {
         if (auto lit = arg(0)->isa<LiteralExpr>())
             return sema.wrap_ref(ref, tuple_type->op(lit->get_u64()));
@@ -958,6 +981,22 @@ const Type* MapExpr::infer(InferSema& sema) const {
     return sema.type_error();
 }
 
+const Type* SliceExpr::infer(InferSema& sema) const {
+    auto ltype = sema.rvalue(lhs());
+    sema.rvalue(begin());
+    sema.rvalue(end());
+
+    if (ltype->isa<SliceType>())
+        return ltype;
+    if (auto ptr_type = ltype->isa<PtrType>()) {
+        auto array_type = ptr_type->pointee()->isa<ArrayType>();
+        if (array_type && !array_type->isa<SimdType>())
+            return sema.slice_type(array_type->elem_type(), ptr_type->is_mut(), ptr_type->addr_space());
+    }
+
+    return ltype->is_known() ? sema.type_error() : sema.find_type(this);
+}
+
 const Type* BlockExpr::infer(InferSema& sema) const {
     for (const auto& stmt : stmts()) {
         if (auto item_stmt = stmt->isa<ItemStmt>())
@@ -1066,6 +1105,20 @@ const Type* LiteralPtrn::infer(InferSema& sema) const {
     return sema.infer(literal());
 }
 
+const Type* RangePtrn::infer(InferSema& sema) const {
+    sema.constrain(hi(), sema.infer(lo()));
+    return sema.infer(hi());
+}
+
+const Type* OrPtrn::infer(InferSema& sema) const {
+    auto type = sema.infer(alt(0));
+    for (size_t i = 1, e = num_alts(); i != e; ++i) {
+        sema.infer(alt(i));
+        type = sema.constrain(alt(i), type);
+    }
+    return type;
+}
+
 //------------------------------------------------------------------------------
 
 /*
@@ -144,10 +144,12 @@ void ASTTypeParamList::bind_ast_type_params(NameSema& sema) const {
 
 void ErrorASTType::bind(NameSema&) const {}
 void PrimASTType::bind(NameSema&) const {}
+void ConstASTType::bind(NameSema&) const {}
 void PtrASTType::bind(NameSema& sema) const { referenced_ast_type()->bind(sema); }
 void IndefiniteArrayASTType::bind(NameSema& sema) const { elem_ast_type()->bind(sema); }
-void DefiniteArrayASTType::bind(NameSema& sema) const { elem_ast_type()->bind(sema); }
-void SimdASTType::bind(NameSema& sema) const { elem_ast_type()->bind(sema); }
+void DefiniteArrayASTType::bind(NameSema& sema) const { elem_ast_type()->bind(sema); dim()->bind(sema); }
+void SimdASTType::bind(NameSema& sema) const { elem_ast_type()->bind(sema); size()->bind(sema); }
+void SliceASTType::bind(NameSema& sema) const { elem_ast_type()->bind(sema); }
 void Typeof::bind(NameSema& sema) const { expr()->bind(sema); }
 
 void TupleASTType::bind(NameSema& sema) const {
@@ -253,6 +255,11 @@ void Fn::fn_bind(NameSema& sema) const {
 }
 
 void FnDecl::bind(NameSema& sema) const {
+    if (is_extern() && abi() == "\"thorin\"") {
+        auto name = fn_symbol().remove_quotation();
+#define IMPALA_INTRINSIC(name_, primop) if (name == #name_) intrinsic_ = Intrinsic_##name_;
+#include "impala/intrinsiclist.h"
+    }
     fn_bind(sema);
 }
 
@@ -351,6 +358,7 @@ void DefiniteArrayExpr::bind(NameSema& sema) const {
 
 void RepeatedDefiniteArrayExpr::bind(NameSema& sema) const {
     value()->bind(sema);
+    count()->bind(sema);
 }
 
 void IndefiniteArrayExpr::bind(NameSema& sema) const {
@@ -358,6 +366,11 @@ void IndefiniteArrayExpr::bind(NameSema& sema) const {
     elem_ast_type()->bind(sema);
 }
 
+void IncludeBytesExpr::bind(NameSema& sema) const {
+    if (elem_ast_type())
+        elem_ast_type()->bind(sema);
+}
+
 void TupleExpr::bind(NameSema& sema) const {
     for (const auto& arg : args())
         arg->bind(sema);
@@ -386,6 +399,12 @@ void MapExpr::bind(NameSema& sema) const {
         arg->bind(sema);
 }
 
+void SliceExpr::bind(NameSema& sema) const {
+    lhs()->bind(sema);
+    begin()->bind(sema);
+    end()->bind(sema);
+}
+
 void IfExpr::bind(NameSema& sema) const {
     cond()->bind(sema);
     then_expr()->bind(sema);
@@ -443,6 +462,13 @@ void EnumPtrn::bind(NameSema& sema) const {
 }
 
 void LiteralPtrn::bind(NameSema&) const {}
+void RangePtrn::bind(NameSema&) const {}
+
+void OrPtrn::bind(NameSema& sema) const {
+    for (const auto& alt : alts()) {
+        alt->bind(sema);
+    }
+}
 
 //------------------------------------------------------------------------------
 
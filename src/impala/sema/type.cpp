@@ -16,6 +16,17 @@ bool is(const Type* type, PrimTypeTag tag) {
     return type->isa<PrimType>() && type->as<PrimType>()->primtype_tag() == tag;
 }
 
+size_t num_bytes(PrimTypeTag tag) {
+    switch (tag) {
+        case PrimType_bool:
+        case PrimType_i8:  case PrimType_u8:  return 1;
+        case PrimType_i16: case PrimType_u16: case PrimType_f16: return 2;
+        case PrimType_i32: case PrimType_u32: case PrimType_f32: return 4;
+        case PrimType_i64: case PrimType_u64: case PrimType_f64: return 8;
+    }
+    THORIN_UNREACHABLE;
+}
+
 bool is_void(const Type* type) {
     if (auto t = type->isa<TupleType>())
         return t->empty();
@@ -60,6 +71,99 @@ const Type* FnType::return_type() const {
     return table().type_noret();
 }
 
+/// A pointer aligned to @p src bytes may be used where @p dst bytes are required.
+static bool is_aligned(const PtrType* dst, const PtrType* src) {
+    return dst->align() == 0 || (src->align() != 0 && src->align() % dst->align() == 0);
+}
+
+static uint64_t round_up(uint64_t n, uint64_t align) { return (n + align - 1) / align * align; }
+
+/// Lays out @p ops one after another; @p decl may pack them and raise their alignment.
+static bool layout_fields(Types ops, const StructDecl* decl, StructLayout& layout) {
+    auto packed = decl && decl->attr("packed");
+    uint64_t end = 0;
+    for (size_t i = 0, e = ops.size(); i != e; ++i) {
+        uint64_t size, natural;
+        if (!type_layout(ops[i], size, natural))
+            return false;
+        auto align = packed ? 1 : natural;
+        if (decl) {
+            auto attr = decl->field_decl(i)->attr("align");
+            if (attr && attr->num_args() == 1)
+                align = std::max(align, attr->arg(0));
+        }
+        auto offset = round_up(end, align);
+        layout.offsets.push_back(offset);
+        layout.misaligned.push_back(offset % natural != 0);
+        layout.align = std::max(layout.align, align);
+        end = offset + size;
+    }
+    if (auto attr = decl ? decl->attr("align") : nullptr) {
+        if (attr->num_args() == 1)
+            layout.align = std::max(layout.align, attr->arg(0));
+    }
+    layout.size = round_up(end, layout.align);
+    // a field must not be aligned more strictly than its struct as arrays of the struct would misalign it
+    for (size_t i = 0, e = ops.size(); i != e; ++i) {
+        uint64_t size, natural;
+        type_layout(ops[i], size, natural);
+        layout.misaligned[i] = layout.misaligned[i] || natural > layout.align;
+    }
+    return true;
+}
+
+bool type_layout(const Type* type, uint64_t& size, uint64_t& align) {
+    if (auto prim_type = type->isa<PrimType>()) {
+        size = align = num_bytes(prim_type->primtype_tag());
+        return true;
+    } else if (type->isa<PtrType>()) {
+        size = align = 8;
+        return true;
+    } else if (auto array_type = type->isa<DefiniteArrayType>()) {
+        if (is_soa(array_type) || !array_type->dim_type()->isa<ConstType>() || !type_layout(array_type->elem_type(), size, align))
+            return false;
+        size *= array_type->dim();
+        return true;
+    } else if (auto simd_type = type->isa<SimdType>()) {
+        if (!simd_type->dim_type()->isa<ConstType>() || !type_layout(simd_type->elem_type(), size, align))
+            return false;
+        size *= simd_type->dim();
+        for (align = 1; align < size; align *= 2) {}
+        return true;
+    } else if (type->isa<TupleType>() || type->isa<StructType>()) {
+        StructLayout layout;
+        if (type->isa<StructType>() ? !struct_layout(type->as<StructType>(), layout) : !layout_fields(type->ops(), nullptr, layout))
+            return false;
+        size = layout.size;
+        align = layout.align;
+        return true;
+    }
+    return false;
+}
+
+bool has_layout_attrs(const StructDecl* decl) {
+    if (decl->attr("packed") || decl->attr("align"))
+        return true;
+    for (const auto& field_decl : decl->field_decls()) {
+        if (field_decl->attr("align"))
+            return true;
+    }
+    return false;
+}
+
+bool struct_layout(const StructType* type, StructLayout& layout) {
+    layout = StructLayout();
+    return layout_fields(type->ops(), type->struct_decl(), layout);
+}
+
+bool is_soa(const Type* type) {
+    if (auto definite_array_type = type->isa<DefiniteArrayType>()) {
+        if (auto struct_type = definite_array_type->elem_type()->isa<StructType>())
+            return struct_type->struct_decl()->attr("soa") != nullptr;
+    }
+    return false;
+}
+
 bool is_subtype(const Type* dst, const Type* src) {
     if (dst == src)
         return true;
@@ -71,15 +175,24 @@ bool is_subtype(const Type* dst, const Type* src) {
     if (auto dst_borrowed_ptr_type = dst->isa<BorrowedPtrType>()) {
         if (auto src_owned_ptr_type = src->isa<OwnedPtrType>()) {
             return src_owned_ptr_type->addr_space() == dst_borrowed_ptr_type->addr_space()
+                && is_aligned(dst_borrowed_ptr_type, src_owned_ptr_type)
                 && is_subtype(dst_borrowed_ptr_type->pointee(), src_owned_ptr_type->pointee());
         } else if (auto src_borrowed_ptr_type = src->isa<BorrowedPtrType>()) {
             return src_borrowed_ptr_type->addr_space() == dst_borrowed_ptr_type->addr_space()
                 && (src_borrowed_ptr_type->is_mut() || !dst_borrowed_ptr_type->is_mut())
+                && is_aligned(dst_borrowed_ptr_type, src_borrowed_ptr_type)
                 && is_subtype(dst_borrowed_ptr_type->pointee(), src_borrowed_ptr_type->pointee());
         }
+    } else if (auto dst_slice_type = dst->isa<SliceType>()) {
+        if (auto src_slice_type = src->isa<SliceType>()) {
+            return src_slice_type->addr_space() == dst_slice_type->addr_space()
+                && (src_slice_type->is_mut() || !dst_slice_type->is_mut())
+                && dst_slice_type->elem_type() == src_slice_type->elem_type();
+        }
     } else if (auto dst_indefinite_array_type = dst->isa<IndefiniteArrayType>()) {
+        // the layout of a #[soa] array depends on its length
         if (auto src_definite_array_type = src->isa<DefiniteArrayType>())
-            return is_subtype(dst_indefinite_array_type->elem_type(), src_definite_array_type->elem_type());
+            return !is_soa(src_definite_array_type) && is_subtype(dst_indefinite_array_type->elem_type(), src_definite_array_type->elem_type());
     }
 
     if (dst->tag() == src->tag() && dst->num_ops() == src->num_ops()) {
@@ -87,12 +200,14 @@ bool is_subtype(const Type* dst, const Type* src) {
 
         // special cases for DefiniteArrays, SimdTypes and PtrTypes
         if (auto dst_def_array = dst->isa<DefiniteArrayType>())
-            result &= src->as<DefiniteArrayType>()->dim() == dst_def_array->dim();
+            result &= src->as<DefiniteArrayType>()->dim_type() == dst_def_array->dim_type();
         else if (auto dst_simd_type = dst->isa<SimdType>())
-            result &= src->as<SimdType>()->dim() == dst_simd_type->dim();
+            result &= src->as<SimdType>()->dim_type() == dst_simd_type->dim_type();
         else if (auto dst_ref_type = dst->isa<RefTypeBase>())
             result &=  src->as<RefTypeBase>()->is_mut() == dst_ref_type->is_mut()
                     && src->as<RefTypeBase>()->addr_space() == dst_ref_type->addr_space();
+        if (auto dst_ptr_type = dst->isa<PtrType>())
+            result &= is_aligned(dst_ptr_type, src->as<PtrType>());
 
         if (auto dst_fn = dst->isa<FnType>()) {
             auto src_fn = src->as<FnType>();
@@ -129,6 +244,10 @@ uint64_t RefTypeBase::vhash() const {
     return thorin::hash_combine(Type::vhash(), ((uint64_t)addr_space() << 1) | uint64_t(is_mut()));
 }
 
+uint64_t PtrType::vhash() const {
+    return thorin::hash_combine(RefTypeBase::vhash(), align());
+}
+
 uint64_t Var::vhash() const {
     return thorin::murmur3(uint64_t(tag()) << uint64_t(56) | uint8_t(depth()));
 }
@@ -145,6 +264,10 @@ bool RefTypeBase::equal(const Type* other) const {
         && this->addr_space() == other->as<RefTypeBase>()->addr_space();
 }
 
+bool PtrType::equal(const Type* other) const {
+    return RefTypeBase::equal(other) && this->align() == other->as<PtrType>()->align();
+}
+
 bool Var::equal(const Type* other) const {
     return other->isa<Var>() ? this->as<Var>()->depth() == other->as<Var>()->depth() : false;
 }
@@ -195,9 +318,27 @@ std::ostream& RefTypeBase::stream(std::ostream& os) const {
     return os << pointee();
 }
 
-std::ostream& DefiniteArrayType::stream(std::ostream& os) const { return streamf(os, "[{} * {}]", elem_type(), dim()); }
+std::ostream& PtrType::stream(std::ostream& os) const {
+    os << prefix();
+    if (addr_space() != 0 && align() != 0)
+        os << '[' << addr_space() << ", align " << align() << ']';
+    else if (addr_space() != 0)
+        os << '[' << addr_space() << ']';
+    else if (align() != 0)
+        os << "[align " << align() << ']';
+    return os << pointee();
+}
+
+std::ostream& ConstType::stream(std::ostream& os) const { return os << value(); }
+std::ostream& DefiniteArrayType::stream(std::ostream& os) const { return streamf(os, "[{} * {}]", elem_type(), dim_type()); }
 std::ostream& IndefiniteArrayType::stream(std::ostream& os) const { return streamf(os, "[{}]", elem_type()); }
-std::ostream& SimdType::stream(std::ostream& os) const { return streamf(os, "simd[{} * {}]", elem_type(), dim()); }
+std::ostream& SimdType::stream(std::ostream& os) const { return streamf(os, "simd[{} * {}]", elem_type(), dim_type()); }
+std::ostream& SliceType::stream(std::ostream& os) const {
+    os << "slice[" << prefix();
+    if (addr_space() != 0)
+        os << '[' << addr_space() << "] ";
+    return os << elem_type() << ']';
+}
 std::ostream& StructType::stream(std::ostream& os) const { return os << struct_decl()->symbol(); }
 std::ostream& EnumType::stream(std::ostream& os) const { return os << enum_decl()->symbol(); }
 std::ostream& TupleType::stream(std::ostream& os) const {
@@ -218,11 +359,13 @@ const Type* Var                ::vrebuild(TypeTable& to, Types    ) const { retu
 const Type* TupleType          ::vrebuild(TypeTable& to, Types ops) const { return to.tuple_type(ops); }
 const Type* StructType         ::vrebuild(TypeTable&   , Types    ) const { return this; }
 const Type* EnumType           ::vrebuild(TypeTable&   , Types    ) const { return this; }
-const Type* DefiniteArrayType  ::vrebuild(TypeTable& to, Types ops) const { return to.  definite_array_type(ops[0], dim()); }
-const Type* SimdType           ::vrebuild(TypeTable& to, Types ops) const { return to.            simd_type(ops[0], dim()); }
+const Type* ConstType          ::vrebuild(TypeTable& to, Types    ) const { return to.           const_type(value()); }
+const Type* DefiniteArrayType  ::vrebuild(TypeTable& to, Types ops) const { return to.  definite_array_type(ops[0], ops[1]); }
+const Type* SimdType           ::vrebuild(TypeTable& to, Types ops) const { return to.            simd_type(ops[0], ops[1]); }
+const Type* SliceType          ::vrebuild(TypeTable& to, Types ops) const { return to.           slice_type(ops[0], is_mut(), addr_space()); }
 const Type* IndefiniteArrayType::vrebuild(TypeTable& to, Types ops) const { return to.indefinite_array_type(ops[0]); }
-const Type* BorrowedPtrType    ::vrebuild(TypeTable& to, Types ops) const { return to.borrowed_ptr_type(ops[0], is_mut(), addr_space()); }
-const Type* OwnedPtrType       ::vrebuild(TypeTable& to, Types ops) const { return to.   owned_ptr_type(ops[0], addr_space()); }
+const Type* BorrowedPtrType    ::vrebuild(TypeTable& to, Types ops) const { return to.borrowed_ptr_type(ops[0], is_mut(), addr_space(), align()); }
+const Type* OwnedPtrType       ::vrebuild(TypeTable& to, Types ops) const { return to.   owned_ptr_type(ops[0], addr_space(), align()); }
 const Type* RefType            ::vrebuild(TypeTable& to, Types ops) const { return to.      ref_type(ops[0], is_mut(), addr_space()); }
 const Type* InferError         ::vrebuild(TypeTable& to, Types ops) const { return to.infer_error(ops[0], ops[1]); }
 const Type* NoRetType          ::vrebuild(TypeTable&,    Types    ) const { return this; }
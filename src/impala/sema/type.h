@@ -1,6 +1,8 @@
 #ifndef IMPALA_SEMA_TYPE_H
 #define IMPALA_SEMA_TYPE_H
 
+#include <vector>
+
 #include "thorin/util/array.h"
 #include "thorin/util/cast.h"
 #include "thorin/util/hash.h"
@@ -15,6 +17,7 @@ enum Tag {
 #include "impala/tokenlist.h"
     Tag_app,
     Tag_borrowed_ptr,
+    Tag_const,
     Tag_definite_array,
     Tag_error,
     Tag_fn,
@@ -27,6 +30,7 @@ enum Tag {
     Tag_pi,
     Tag_ref,
     Tag_simd,
+    Tag_slice,
     Tag_struct,
     Tag_enum,
     Tag_tuple,
@@ -82,6 +86,9 @@ bool is(const Type*, PrimTypeTag tag);
 inline bool is_float(const Type* t) { return             is_f16(t) || is_f32(t) || is_f64(t); }
 inline bool is_int  (const Type* t) { return is_i8(t) || is_i16(t) || is_i32(t) || is_i64(t)
                                           || is_u8(t) || is_u16(t) || is_u32(t) || is_u64(t); }
+inline bool is_signed(const Type* t) { return is_i8(t) || is_i16(t) || is_i32(t) || is_i64(t); }
+/// Size in bytes of a value of the primitive type @p tag.
+size_t num_bytes(PrimTypeTag tag);
 bool is_void(const Type*);
 bool is_subtype(const Type* dst, const Type* src);
 bool is_strict_subtype(const Type* dst, const Type* src);
@@ -117,22 +124,31 @@ private:
 /// Pointer @p Type.
 class PtrType : public RefTypeBase {
 protected:
-    PtrType(TypeTable& typetable, int tag, const Type* pointee, bool mut, int addr_space)
+    PtrType(TypeTable& typetable, int tag, const Type* pointee, bool mut, int addr_space, int align)
         : RefTypeBase(typetable, tag, pointee, mut, addr_space)
+        , align_(align)
     {}
 
     std::ostream& stream_ptr_type(std::ostream&, std::string prefix, int addr_space, const Type* ref_type) const;
 
+public:
+    /// Guaranteed alignment of the pointee in bytes or 0 if nothing is known.
+    int align() const { return align_; }
+
+    virtual std::ostream& stream(std::ostream&) const override;
+    virtual uint64_t vhash() const override;
+    virtual bool equal(const Type* other) const override;
+
 private:
-    int addr_space_;
+    int align_;
 
     friend class TypeTable;
 };
 
 class BorrowedPtrType : public PtrType {
 public:
-    BorrowedPtrType(TypeTable& typetable, const Type* pointee, bool mut, int addr_space)
-        : PtrType(typetable, Tag_borrowed_ptr, pointee, mut, addr_space)
+    BorrowedPtrType(TypeTable& typetable, const Type* pointee, bool mut, int addr_space, int align)
+        : PtrType(typetable, Tag_borrowed_ptr, pointee, mut, addr_space, align)
     {}
 
     virtual std::string prefix() const override { return is_mut() ? "&mut " : "&"; }
@@ -143,8 +159,8 @@ private:
 
 class OwnedPtrType : public PtrType {
 public:
-    OwnedPtrType(TypeTable& typetable, const Type* pointee, int addr_space)
-        : PtrType(typetable, Tag_owned_ptr, pointee, true, addr_space)
+    OwnedPtrType(TypeTable& typetable, const Type* pointee, int addr_space, int align)
+        : PtrType(typetable, Tag_owned_ptr, pointee, true, addr_space, align)
     {}
 
     virtual std::string prefix() const override { return "~"; }
@@ -343,10 +359,35 @@ private:
 
 //------------------------------------------------------------------------------
 
+/// Integer argument of a const type parameter - the dimension of a @p DefiniteArrayType or @p SimdType.
+class ConstType : public Type {
+private:
+    ConstType(TypeTable& typetable, uint64_t value)
+        : Type(typetable, Tag_const, {})
+        , value_(value)
+    {}
+
+public:
+    uint64_t value() const { return value_; }
+    virtual uint64_t vhash() const override { return thorin::hash_combine(Type::vhash(), value()); }
+    virtual bool equal(const Type* other) const override {
+        return Type::equal(other) && this->value() == other->as<ConstType>()->value();
+    }
+
+    virtual std::ostream& stream(std::ostream&) const override;
+
+private:
+    virtual const Type* vrebuild(TypeTable&, Types) const override;
+
+    uint64_t value_;
+
+    friend class TypeTable;
+};
+
 class ArrayType : public Type {
 protected:
-    ArrayType(TypeTable& typetable, int tag, const Type* elem_type)
-        : Type(typetable, tag, {elem_type})
+    ArrayType(TypeTable& typetable, int tag, Types ops)
+        : Type(typetable, tag, ops)
     {}
 
 public:
@@ -356,7 +397,7 @@ public:
 class IndefiniteArrayType : public ArrayType {
 public:
     IndefiniteArrayType(TypeTable& typetable, const Type* elem_type)
-        : ArrayType(typetable, Tag_indefinite_array, elem_type)
+        : ArrayType(typetable, Tag_indefinite_array, {elem_type})
     {}
 
     virtual std::ostream& stream(std::ostream&) const override;
@@ -367,48 +408,62 @@ private:
     friend class TypeTable;
 };
 
+/// Array of @p dim elements - a @p ConstType or the @p Var of a const type parameter.
 class DefiniteArrayType : public ArrayType {
 public:
-    DefiniteArrayType(TypeTable& typetable, const Type* elem_type, uint64_t dim)
-        : ArrayType(typetable, Tag_definite_array, elem_type)
-        , dim_(dim)
+    DefiniteArrayType(TypeTable& typetable, const Type* elem_type, const Type* dim)
+        : ArrayType(typetable, Tag_definite_array, {elem_type, dim})
     {}
 
-    uint64_t dim() const { return dim_; }
-    virtual uint64_t vhash() const override { return thorin::hash_combine(Type::vhash(), dim()); }
-    virtual bool equal(const Type* other) const override {
-        return Type::equal(other) && this->dim() == other->as<DefiniteArrayType>()->dim();
-    }
+    const Type* dim_type() const { return op(1); }
+    /// Number of elements - only valid if not depending on a const type parameter.
+    uint64_t dim() const { return dim_type()->as<ConstType>()->value(); }
 
     virtual std::ostream& stream(std::ostream&) const override;
 
 private:
     virtual const Type* vrebuild(TypeTable&, Types) const override;
 
-    uint64_t dim_;
-
     friend class TypeTable;
 };
 
+/// Is @p type a @p DefiniteArrayType of a <tt>#[soa]</tt> struct? Its elements are stored as one array per field.
+bool is_soa(const Type* type);
+
+/// Vector of @p dim lanes - a @p ConstType or the @p Var of a const type parameter.
 class SimdType : public ArrayType {
 public:
-    SimdType(TypeTable& typetable, const Type* elem_type, uint64_t dim)
-        : ArrayType(typetable, Tag_simd, elem_type)
-        , dim_(dim)
+    SimdType(TypeTable& typetable, const Type* elem_type, const Type* dim)
+        : ArrayType(typetable, Tag_simd, {elem_type, dim})
     {}
 
-    uint64_t dim() const { return dim_; }
-    virtual uint64_t vhash() const override { return thorin::hash_combine(Type::vhash(), dim()); }
-    virtual bool equal(const Type* other) const override {
-        return Type::equal(other) && this->dim() == other->as<SimdType>()->dim();
-    }
+    const Type* dim_type() const { return op(1); }
+    /// Number of lanes - only valid if not depending on a const type parameter.
+    uint64_t dim() const { return dim_type()->as<ConstType>()->value(); }
 
     virtual std::ostream& stream(std::ostream&) const override;
 
 private:
     virtual const Type* vrebuild(TypeTable&, Types) const override;
 
-    uint64_t dim_;
+    friend class TypeTable;
+};
+
+/// Fat pointer to @p elem_type%s: a pointer to the first element and the number of elements as @c i64.
+/// Like a pointer, a slice lives in an address space and only allows writes to its elements if it is mutable.
+class SliceType : public RefTypeBase {
+public:
+    SliceType(TypeTable& typetable, const Type* elem_type, bool mut, int addr_space)
+        : RefTypeBase(typetable, Tag_slice, elem_type, mut, addr_space)
+    {}
+
+    const Type* elem_type() const { return pointee(); }
+
+    virtual std::string prefix() const override { return is_mut() ? "mut " : ""; }
+    virtual std::ostream& stream(std::ostream&) const override;
+
+private:
+    virtual const Type* vrebuild(TypeTable&, Types) const override;
 
     friend class TypeTable;
 };
@@ -488,6 +543,24 @@ inline bool is_unit(const Type* t) {
 
 //------------------------------------------------------------------------------
 
+/// Memory layout of a struct or tuple as C lays it out.
+struct StructLayout {
+    uint64_t size = 0;
+    uint64_t align = 1;
+    std::vector<uint64_t> offsets;
+    /// Fields of packed structs which are not aligned as their types require.
+    std::vector<bool> misaligned;
+};
+
+/// Size and alignment of @p type in memory; returns false if they are not fixed. Pointers take 8 bytes.
+bool type_layout(const Type* type, uint64_t& size, uint64_t& align);
+/// Does @p decl change the default layout with the attributes 'packed' or 'align'?
+bool has_layout_attrs(const StructDecl* decl);
+/// Layout of @p type honoring the attributes 'packed' and 'align' of its declaration and its fields.
+bool struct_layout(const StructType* type, StructLayout& layout);
+
+//------------------------------------------------------------------------------
+
 class TypeTable : public thorin::TypeTableBase<Type> {
 public:
     TypeTable();
@@ -504,20 +577,28 @@ public:
 
 #define IMPALA_TYPE(itype, atype) const PrimType* type_##itype() { return itype##_; }
 #include "impala/tokenlist.h"
-    const DefiniteArrayType* definite_array_type(const Type* elem_type, uint64_t dim) {
+    const ConstType* const_type(uint64_t value) { return unify(new ConstType(*this, value)); }
+    const DefiniteArrayType* definite_array_type(const Type* elem_type, const Type* dim) {
         return unify(new DefiniteArrayType(*this, elem_type, dim));
     }
+    const DefiniteArrayType* definite_array_type(const Type* elem_type, uint64_t dim) {
+        return definite_array_type(elem_type, const_type(dim));
+    }
     const FnType* fn_type(const Type* op) { return unify(new FnType(*this, op)); }
     const FnType* fn_type(Types params) { return unify(new FnType(*this, params.size() == 1 ? params.front() : tuple_type(params))); }
     const IndefiniteArrayType* indefinite_array_type(const Type* elem_type) {
         return unify(new IndefiniteArrayType(*this, elem_type));
     }
-    const SimdType* simd_type(const Type* elem_type, uint64_t size) { return unify(new SimdType(*this, elem_type, size)); }
-    const BorrowedPtrType* borrowed_ptr_type(const Type* pointee, bool mut, int addr_space) {
-        return unify(new BorrowedPtrType(*this, pointee, mut, addr_space));
+    const SimdType* simd_type(const Type* elem_type, const Type* size) { return unify(new SimdType(*this, elem_type, size)); }
+    const SimdType* simd_type(const Type* elem_type, uint64_t size) { return simd_type(elem_type, const_type(size)); }
+    const SliceType* slice_type(const Type* elem_type, bool mut, int addr_space) {
+        return unify(new SliceType(*this, elem_type, mut, addr_space));
+    }
+    const BorrowedPtrType* borrowed_ptr_type(const Type* pointee, bool mut, int addr_space, int align = 0) {
+        return unify(new BorrowedPtrType(*this, pointee, mut, addr_space, align));
     }
-    const OwnedPtrType* owned_ptr_type(const Type* pointee, int addr_space) {
-        return unify(new OwnedPtrType(*this, pointee, addr_space));
+    const OwnedPtrType* owned_ptr_type(const Type* pointee, int addr_space, int align = 0) {
+        return unify(new OwnedPtrType(*this, pointee, addr_space, align));
     }
     const RefType* ref_type(const Type* pointee, bool mut, int addr_space) {
         return unify(new RefType(*this, pointee, mut, addr_space));
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <functional>
+#include <limits>
 #include <sstream>
 
 #include "impala/ast.h"
@@ -144,6 +147,57 @@ void ASTTypeParamList::check_ast_type_params(TypeSema& sema) const {
         sema.check(ast_type_param.get());
 }
 
+void AttrList::check_attrs(const char* what, std::initializer_list<std::pair<const char*, size_t>> num_args) const {
+    for (size_t i = 0, e = attrs().size(); i != e; ++i) {
+        auto attr = attrs()[i].get();
+        auto known = std::find_if(num_args.begin(), num_args.end(), [&] (const auto& p) { return attr->symbol() == p.first; });
+        if (known == num_args.end())
+            error(attr, "unknown attribute '{}' for {}", attr->symbol(), what);
+        else if (attr->num_args() > known->second)
+            error(attr, "too many arguments for attribute '{}': got {}, expected at most {}", attr->symbol(), attr->num_args(), known->second);
+        for (size_t j = 0; j != i; ++j) {
+            if (attrs()[j]->symbol() == attr->symbol())
+                error(attr, "attribute '{}' given more than once", attr->symbol());
+        }
+    }
+}
+
+/// Function attributes which end up on the LLVM function - see @c CodeGen::annotate.
+static const char* llvm_fn_attrs[] = {"noinline", "hot", "cold", "target_cpu", "target_features"};
+
+void Fn::check_fn_attrs() const {
+    check_attrs("function", {{"always_inline", 0}, {"noinline", 0}, {"hot", 0}, {"cold", 0}, {"target_cpu", 1}, {"target_features", 1},
+                             {"fast_math", 0}, {"reassoc", 0}, {"contract", 0}, {"nnan", 0}, {"ninf", 0}, {"arcp", 0}});
+    if (attr("always_inline") && attr("noinline"))
+        error(attr("noinline"), "conflicting attributes 'always_inline' and 'noinline'");
+    if (attr("hot") && attr("cold"))
+        error(attr("cold"), "conflicting attributes 'hot' and 'cold'");
+    for (auto name : {"target_cpu", "target_features"}) {
+        if (auto target = attr(name)) {
+            if (target->num_strs() != 1 || target->num_args() != 0)
+                error(target, "attribute '{}' expects a string argument", name);
+        }
+    }
+
+    if (!body() && attr("always_inline"))
+        warning(attr("always_inline"), "attribute 'always_inline' has no effect on a function without body");
+}
+
+/// Checks the loop hints of a while or for loop.
+static void check_loop_attrs(const AttrList* loop, bool is_for) {
+    auto unroll = loop->attr("unroll");
+    if (unroll && unroll->num_args() == 1 && unroll->arg(0) == 0)
+        error(unroll, "unroll count must not be zero");
+    if (unroll && unroll->num_args() == 0 && !is_for)
+        error(unroll, "complete unrolling needs a for loop; give an unroll count for while loops");
+    if (unroll && loop->attr("no_unroll"))
+        error(loop->attr("no_unroll"), "conflicting attributes 'unroll' and 'no_unroll'");
+
+    auto vectorize = loop->attr("vectorize");
+    if (vectorize && vectorize->num_args() == 1 && (vectorize->arg(0) == 0 || (vectorize->arg(0) & (vectorize->arg(0) - 1)) != 0))
+        error(vectorize, "vectorization width must be a power of two, got {}", vectorize->arg(0));
+}
+
 //------------------------------------------------------------------------------
 
 /*
@@ -152,13 +206,40 @@ void ASTTypeParamList::check_ast_type_params(TypeSema& sema) const {
 
 void ErrorASTType::check(TypeSema& ) const {}
 void PrimASTType::check(TypeSema&) const {}
-void PtrASTType::check(TypeSema& sema) const { sema.check(referenced_ast_type()); }
-void IndefiniteArrayASTType::check(TypeSema& sema) const { sema.check(elem_ast_type()); }
-void   DefiniteArrayASTType::check(TypeSema& sema) const { sema.check(elem_ast_type()); }
+void PtrASTType::check(TypeSema& sema) const {
+    sema.check(referenced_ast_type());
+    if (align() < 0 || (align() & (align() - 1)) != 0)
+        error(this, "alignment of pointer type must be a power of two, got {}", align());
+}
+
+void IndefiniteArrayASTType::check(TypeSema& sema) const {
+    auto elem_type = sema.check(elem_ast_type());
+    if (auto struct_type = elem_type->isa<StructType>()) {
+        if (struct_type->struct_decl()->attr("soa"))
+            warning(this, "#[soa] has no effect on indefinite array '{}'; it keeps the array-of-structs layout", type());
+    }
+}
+void ConstASTType::check(TypeSema&) const {}
+void SliceASTType::check(TypeSema& sema) const { sema.check(elem_ast_type()); }
+
+/// Dimensions of array and simd types are integer literals or const type parameters.
+static void check_dim(const ASTType* dim) {
+    if (auto ast_type_app = dim->isa<ASTTypeApp>()) {
+        auto ast_type_param = ast_type_app->decl() ? ast_type_app->decl()->isa<ASTTypeParam>() : nullptr;
+        if (ast_type_app->decl() && !(ast_type_param && ast_type_param->is_const()))
+            error(dim, "expected integer literal or const type parameter as dimension but found '{}'", dim);
+    }
+}
+
+void DefiniteArrayASTType::check(TypeSema& sema) const {
+    sema.check(elem_ast_type());
+    check_dim(dim());
+}
 
 void SimdASTType::check(TypeSema& sema) const {
     if (!sema.check(elem_ast_type())->isa<PrimType>())
         error(this, "non primitive types forbidden in simd type");
+    check_dim(size());
 }
 
 void TupleASTType::check(TypeSema& sema) const {
@@ -176,10 +257,38 @@ void FnASTType::check(TypeSema& sema) const {
     }
 }
 
+/// Whether @p ast_type_arg is an integer - a literal or a const type parameter.
+static bool is_const_arg(const ASTType* ast_type_arg) {
+    if (ast_type_arg->isa<ConstASTType>())
+        return true;
+    if (auto ast_type_app = ast_type_arg->isa<ASTTypeApp>()) {
+        if (auto ast_type_param = ast_type_app->decl() ? ast_type_app->decl()->isa<ASTTypeParam>() : nullptr)
+            return ast_type_param->is_const();
+    }
+    return false;
+}
+
+/// Integers must be passed to const type parameters and types to all others.
+static void check_type_args(const ASTTypeParamList* list, ASTTypeArgs ast_type_args) {
+    for (size_t i = 0, e = std::min(list->num_ast_type_params(), ast_type_args.size()); i != e; ++i) {
+        auto ast_type_param = list->ast_type_param(i);
+        auto ast_type_arg = ast_type_args[i].get();
+        if (ast_type_param->is_const() && !is_const_arg(ast_type_arg))
+            error(ast_type_arg, "expected integer as argument of const type parameter '{}' but found '{}'", ast_type_param->symbol(), ast_type_arg);
+        else if (!ast_type_param->is_const() && is_const_arg(ast_type_arg))
+            error(ast_type_arg, "expected type as argument of type parameter '{}' but found '{}'", ast_type_param->symbol(), ast_type_arg);
+    }
+}
+
 void ASTTypeApp::check(TypeSema& sema) const {
     path()->check(sema);
     if (!decl() || !decl()->is_type_decl())
         error(identifier(), "'{}' does not name a type", symbol());
+    else if (auto ast_type_param = decl()->isa<ASTTypeParam>()) {
+        if (ast_type_param->is_const())
+            error(this, "const type parameter '{}' used as type", symbol());
+    } else if (auto type_decl_item = decl()->isa<TypeDeclItem>())
+        check_type_args(type_decl_item, ast_type_args());
 }
 
 void Typeof::check(TypeSema& sema) const { sema.check(expr()); }
@@ -193,6 +302,10 @@ void LocalDecl::check(TypeSema& sema) const {
     sema.expect_known(this);
     sema.no_indefinite_array(ast_type() ? ast_type()->as<ASTNode>() : identifier()->as<ASTNode>(), type(),
             isa<Param>() ? "parameter type" : "type for a local variable");
+    if (auto param = isa<Param>()) {
+        if (param->is_noalias() && type()->is_known() && !type()->isa<PtrType>())
+            error(this, "noalias parameter '{}' must be a pointer but has type '{}'", symbol(), type());
+    }
 }
 
 const Type* Fn::check_body(TypeSema& sema) const {
@@ -260,19 +373,59 @@ void OptionDecl::check(TypeSema& sema) const {
     for (const auto& arg : args()) sema.check(arg.get());
 }
 
+/// Alignments given with the attribute 'align' are powers of two.
+static void check_align_attr(const AttrList* list) {
+    if (auto align = list->attr("align")) {
+        if (align->num_args() != 1 || align->arg(0) == 0 || (align->arg(0) & (align->arg(0) - 1)) != 0)
+            error(align, "attribute 'align' expects a power of two");
+    }
+}
+
 void StructDecl::check(TypeSema& sema) const {
+    check_attrs("struct", {{"soa", 0}, {"packed", 0}, {"align", 1}});
+    check_align_attr(this);
     check_ast_type_params(sema);
     for (const auto& field_decl : field_decls()) {
         sema.check(field_decl.get());
         sema.no_indefinite_array(field_decl.get(), field_decl->type(), "type for a struct field");
     }
+
+    if (has_layout_attrs(this)) {
+        StructLayout layout;
+        if (!struct_layout(struct_type(), layout)) {
+            error(this, "struct '{}' with layout attributes needs fields of fixed size", symbol());
+            return;
+        }
+        // misaligned fields are stored as bytes which only works for scalars
+        for (size_t i = 0, e = num_field_decls(); i != e; ++i) {
+            auto type = field_decl(i)->type();
+            if (layout.misaligned[i] && !type->isa<PrimType>() && !type->isa<PtrType>())
+                error(field_decl(i), "field '{}' of type '{}' would be misaligned in packed struct '{}'", field_decl(i)->symbol(), type, symbol());
+        }
+    }
 }
 
-void FieldDecl::check(TypeSema& sema) const { sema.check(ast_type()); }
+void FieldDecl::check(TypeSema& sema) const {
+    check_attrs("struct field", {{"align", 1}});
+    check_align_attr(this);
+    sema.check(ast_type());
+}
 
 void FnDecl::check(TypeSema& sema) const {
     THORIN_PUSH(sema.cur_fn_, this);
     check_ast_type_params(sema);
+    check_fn_attrs();
+    // a function with LLVM attributes is made external to keep thorin from inlining it - which needs a first-order function
+    if (type()->is_known() && !type()->isa<TypeError>() && fn_type()->order() > 2) {
+        for (auto name : llvm_fn_attrs) {
+            if (auto attr = this->attr(name))
+                error(attr, "attribute '{}' needs a function without function parameters", name);
+        }
+        for (const auto& param : params()) {
+            if (param->is_noalias())
+                error(param.get(), "noalias parameter '{}' needs a function without function parameters", param->symbol());
+        }
+    }
     for (const auto& param : params())
         sema.check(param.get());
 
@@ -323,6 +476,15 @@ void StrExpr::check(TypeSema&) const {}
 void FnExpr::check(TypeSema& sema) const {
     THORIN_PUSH(sema.cur_fn_, this);
     assert(ast_type_params().empty());
+    check_fn_attrs();
+    for (auto name : llvm_fn_attrs) {
+        if (auto attr = this->attr(name))
+            error(attr, "attribute '{}' needs a function item", name);
+    }
+    for (const auto& param : params()) {
+        if (param->is_noalias())
+            error(param.get(), "noalias parameter '{}' needs a function item", param->symbol());
+    }
 
     for (size_t i = 0, e = num_params(); i != e; ++i)
         sema.check(param(i));
@@ -343,17 +505,40 @@ void PathExpr::check(TypeSema& sema) const {
         error(this, "expected value but found '{}'", path());
 }
 
+/// Elements of <tt>#[soa]</tt> arrays are spread over one array per field and have no address of their own.
+static void no_soa_elem(const Expr* expr, const char* what) {
+    if (auto map = expr->isa<MapExpr>()) {
+        if (is_soa(unpack_ref_type(map->lhs()->type())))
+            error(expr, "cannot take address of an element of a #[soa] array with '{}'", what);
+    }
+}
+
+/// Misaligned fields of packed structs are stored as bytes and can't be accessed through a pointer of their type.
+static void no_misaligned_field(const Expr* expr, const char* what) {
+    if (auto field = expr->isa<FieldExpr>()) {
+        auto struct_type = unpack_ref_type(field->lhs()->type())->isa<StructType>();
+        StructLayout layout;
+        if (struct_type && field->field_decl() && has_layout_attrs(struct_type->struct_decl())
+                && struct_layout(struct_type, layout) && layout.misaligned[field->index()])
+            error(expr, "cannot take address of misaligned field '{}' of packed struct '{}' with '{}'", field->symbol(), struct_type, what);
+    }
+}
+
 void PrefixExpr::check(TypeSema& sema) const {
     sema.check(rhs());
 
     switch (tag()) {
         case AND:
             rhs()->take_address();
+            no_soa_elem(rhs(), "&");
+            no_misaligned_field(rhs(), "&");
             return;
         case MUT:
             rhs()->write();
             rhs()->take_address();
             sema.expect_lvalue(rhs(), "operand of '&mut'");
+            no_soa_elem(rhs(), "&mut");
+            no_misaligned_field(rhs(), "&mut");
             return;
         case TILDE:
             return;
@@ -521,7 +706,10 @@ void TupleExpr::check(TypeSema& sema) const {
     }
 }
 
-void RepeatedDefiniteArrayExpr::check(TypeSema& sema) const { sema.check(value()); }
+void RepeatedDefiniteArrayExpr::check(TypeSema& sema) const {
+    sema.check(value());
+    check_dim(count());
+}
 
 void IndefiniteArrayExpr::check(TypeSema& sema) const {
     sema.check(dim());
@@ -529,6 +717,21 @@ void IndefiniteArrayExpr::check(TypeSema& sema) const {
     sema.check(elem_ast_type());
 }
 
+void IncludeBytesExpr::check(TypeSema& sema) const {
+    if (!elem_ast_type())
+        return;
+
+    auto elem_type = sema.check(elem_ast_type());
+    if (!is_int(elem_type) && !is_float(elem_type)) {
+        if (elem_type->is_known() && !elem_type->isa<TypeError>())
+            error(elem_ast_type(), "expected integer or floating-point element type in include_bytes expression, got '{}'", elem_type);
+    } else {
+        auto size = num_bytes(elem_type->as<PrimType>()->primtype_tag());
+        if (bytes().size() % size != 0)
+            error(this, "size of file '{}' ({} bytes) is not a multiple of the size of '{}'", path(), bytes().size(), elem_type);
+    }
+}
+
 void DefiniteArrayExpr::check(TypeSema& sema) const {
     const Type* elem_type = nullptr;
     if (auto definite_array_type = type()->isa<DefiniteArrayType>())
@@ -583,7 +786,10 @@ void StructExpr::check(TypeSema& sema) const {
 void FieldExpr::check(TypeSema& sema) const {
     auto type = unpack_ref_type(sema.check(lhs()));
 
-    if (auto struct_type = type->isa<StructType>()) {
+    if (type->isa<SliceType>()) {
+        if (symbol() != "len")
+            error(lhs(), "attempted access of field '{}' on slice '{}', but slices only have field 'len'", symbol(), type);
+    } else if (auto struct_type = type->isa<StructType>()) {
         auto struct_decl = struct_type->struct_decl();
         if (auto field_decl = struct_decl->field_decl(symbol()))
             field_decl_ = field_decl;
@@ -594,6 +800,328 @@ void FieldExpr::check(TypeSema& sema) const {
 }
 
 void TypeAppExpr::check(TypeSema& /*sema*/) const {
+    if (auto path = lhs()->skip_rvalue()->isa<PathExpr>()) {
+        if (auto fn_decl = path->value_decl() ? path->value_decl()->isa<FnDecl>() : nullptr)
+            check_type_args(fn_decl, ast_type_args());
+    }
+}
+
+/// Returns the function declaration called by @p map or @c nullptr if it is called indirectly.
+static const FnDecl* callee(const MapExpr* map) {
+    auto lhs = map->lhs()->skip_rvalue();
+    if (auto type_app = lhs->isa<TypeAppExpr>())
+        lhs = type_app->lhs()->skip_rvalue();
+    if (auto path = lhs->isa<PathExpr>())
+        return path->value_decl() ? path->value_decl()->isa<FnDecl>() : nullptr;
+    return nullptr;
+}
+
+/// Returns the intrinsic called by @p map or @p Intrinsic_None.
+static Intrinsic intrinsic(const MapExpr* map) {
+    auto fn_decl = callee(map);
+    return fn_decl ? fn_decl->intrinsic() : Intrinsic_None;
+}
+
+/**
+ * Returns the variable whose whole memory the pointer @p expr refers to - e.g. @c a for <tt>&mut a</tt> or @c p for @c p.
+ * Returns @c nullptr if this is unknown or if @p expr only points to a part of it.
+ */
+static const Decl* pointer_root(const Expr* expr) {
+    while (true) {
+        expr = expr->skip_rvalue();
+        if (auto cast = expr->isa<CastExpr>())
+            expr = cast->src();
+        else if (auto prefix = expr->isa<PrefixExpr>()) {
+            if (prefix->tag() != PrefixExpr::AND && prefix->tag() != PrefixExpr::MUT)
+                return nullptr;
+            expr = prefix->rhs();
+        } else if (auto path = expr->isa<PathExpr>())
+            return path->value_decl();
+        else
+            return nullptr;
+    }
+}
+
+/// Rejects calls which pass the same memory to a @c noalias parameter and another writable pointer parameter.
+static void check_noalias(const MapExpr* map, const FnDecl* fn_decl) {
+    if (fn_decl->num_params() < map->num_args())
+        return;
+
+    auto is_mut = [&] (size_t i) {
+        auto ptr_type = map->arg(i)->type()->isa<PtrType>();
+        return ptr_type && ptr_type->is_mut();
+    };
+
+    for (size_t i = 0, e = map->num_args(); i != e; ++i) {
+        auto root = pointer_root(map->arg(i));
+        if (root == nullptr)
+            continue;
+        for (size_t j = i + 1; j != e; ++j) {
+            auto noalias = fn_decl->param(i)->is_noalias() ? fn_decl->param(i) : fn_decl->param(j);
+            if ((fn_decl->param(i)->is_noalias() || fn_decl->param(j)->is_noalias())
+                    && (is_mut(i) || is_mut(j))
+                    && pointer_root(map->arg(j)) == root)
+                error(map->arg(j), "'{}' is passed to noalias parameter '{}' and to another pointer parameter", root->symbol(), noalias->symbol());
+        }
+    }
+}
+
+static bool is_simd(const Type* type, const Type* elem_type, const Type* dim) {
+    auto simd_type = type->isa<SimdType>();
+    return simd_type && simd_type->elem_type() == elem_type && simd_type->dim_type() == dim;
+}
+
+/**
+ * The simd and memory intrinsics are declared with unconstrained type parameters.
+ * Their actual signatures are checked here:
+@code{.rs}
+fn shuffle(a: simd[T * N], b: simd[T * N], mask: simd[i32 * M]) -> simd[T * M]; // mask: literals < 2 * N
+fn reduce_add(v: simd[T * N]) -> T; // also reduce_mul, reduce_min, reduce_max
+fn gather(p: &[T], index: simd[i32 * N]) -> simd[T * N];
+fn scatter(p: &mut [T], index: simd[i32 * N], v: simd[T * N]) -> ();
+fn masked_load(p: &[T], mask: simd[bool * N], passthru: simd[T * N]) -> simd[T * N];
+fn masked_store(p: &mut [T], mask: simd[bool * N], v: simd[T * N]) -> ();
+fn prefetch(p: &T, rw: i32, locality: i32) -> (); // rw: literal 0 (read) or 1 (write); locality: literal 0 - 3
+fn add_sat(a: T, b: T) -> T; // T: integer type or simd vector of integers; also sub_sat
+fn add_overflow(a: T, b: T) -> (T, bool); // for simd[U * N]: (simd[U * N], simd[bool * N]); also sub_overflow, mul_overflow
+fn mulhi(a: T, b: T) -> T; // high half of the full product
+fn atomic(op: u32, p: &mut T, v: T, order: u32) -> T; // order is optional
+fn cmpxchg(p: &mut T, cmp: T, new: T, success: u32, failure: u32) -> (T, bool); // orders are optional; also cmpxchg_weak
+fn atomic_load(p: &T, order: u32) -> T; // T: integer or float type; order: relaxed, acquire or seq_cst
+fn atomic_store(p: &mut T, v: T, order: u32) -> (); // T: integer or float type; order: relaxed, release or seq_cst
+fn fence(order: u32) -> (); // order: acquire, release, acq_rel or seq_cst
+fn store_nontemporal(p: &mut T, v: T) -> (); // T: primitive or simd type
+@endcode
+ * Memory orderings are integer literals with the values of LLVM's @c AtomicOrdering:
+ * 2 (relaxed), 4 (acquire), 5 (release), 6 (acq_rel) and 7 (seq_cst).
+ * The op of an @c atomic with an order is a literal with the value of LLVM's @c AtomicRMWInst::BinOp (0 - 10).
+ */
+static void check_intrinsic(const MapExpr* map, Intrinsic intrinsic) {
+    auto simd_arg = [&] (size_t i, const char* what) -> const SimdType* {
+        auto type = map->arg(i)->type();
+        auto simd_type = type->isa<SimdType>();
+        if (!simd_type && type->is_known() && !type->isa<TypeError>())
+            error(map->arg(i), "mismatched types: expected simd type but found '{}' as {}", type, what);
+        return simd_type;
+    };
+    auto elem_type = [&] (size_t i, bool mut) -> const Type* {
+        auto type = map->arg(i)->type();
+        auto ptr_type = type->isa<PtrType>();
+        auto array_type = ptr_type ? ptr_type->pointee()->isa<ArrayType>() : nullptr;
+        if (!array_type || array_type->isa<SimdType>() || !array_type->elem_type()->isa<PrimType>()) {
+            if (type->is_known() && !type->isa<TypeError>())
+                error(map->arg(i), "mismatched types: expected pointer to array of primitive type but found '{}' as first argument of '{}'", type, map->lhs());
+            return nullptr;
+        }
+        if (mut && ptr_type->isa<BorrowedPtrType>() && !ptr_type->is_mut())
+            error(map->arg(i), "mutable pointer required as first argument of '{}'", map->lhs());
+        return array_type->elem_type();
+    };
+    auto expect_simd = [&] (const Typeable* node, const Type* elem_type, const Type* dim, const char* what) {
+        if (!is_simd(node->type(), elem_type, dim) && node->type()->is_known() && !node->type()->isa<TypeError>())
+            error(node, "mismatched types: expected 'simd[{} * {}]' but found '{}' as {}", elem_type, dim, node->type(), what);
+    };
+    auto num_args = [&] (size_t num) {
+        if (map->num_args() == num)
+            return true;
+        error(map, "incorrect number of arguments for '{}': got {}, expected {}", map->lhs(), map->num_args(), num);
+        return false;
+    };
+    // returns the memory ordering given as argument @p i or 0 if it is invalid
+    auto order_arg = [&] (size_t i, const char* what, std::initializer_list<uint64_t> valid) -> uint64_t {
+        auto literal = map->arg(i)->isa<LiteralExpr>();
+        if (!literal || !is_int(literal->type())) {
+            error(map->arg(i), "{} of '{}' must be an integer literal", what, map->lhs());
+            return 0;
+        }
+        auto order = literal->get_u64();
+        if (std::find(valid.begin(), valid.end(), order) == valid.end()) {
+            error(map->arg(i), "invalid {} {} for '{}'", what, order, map->lhs());
+            return 0;
+        }
+        return order;
+    };
+
+    switch (intrinsic) {
+        case Intrinsic_shuffle: {
+            if (!num_args(3)) return;
+            auto simd_type = simd_arg(0, "first argument of 'shuffle'");
+            auto mask = map->arg(2)->isa<SimdExpr>();
+            if (!mask) {
+                error(map->arg(2), "shuffle mask must be a simd expression of integer literals");
+                return;
+            }
+            for (const auto& lane : mask->args()) {
+                auto literal = lane->isa<LiteralExpr>();
+                if (!literal || !is_int(literal->type()))
+                    error(lane.get(), "shuffle mask must be a simd expression of integer literals");
+                else if (auto lanes = simd_type ? simd_type->dim_type()->isa<ConstType>() : nullptr) {
+                    if (literal->get_u64() >= 2 * lanes->value())
+                        error(lane.get(), "shuffle index {} out of range for two vectors of {} lanes", literal->get_u64(), lanes->value());
+                }
+            }
+            if (simd_type && mask->type()->isa<SimdType>())
+                expect_simd(map, simd_type->elem_type(), mask->type()->as<SimdType>()->dim_type(), "result of 'shuffle'");
+            return;
+        }
+        case Intrinsic_reduce_add:
+        case Intrinsic_reduce_mul:
+        case Intrinsic_reduce_min:
+        case Intrinsic_reduce_max: {
+            if (!num_args(1)) return;
+            if (auto simd_type = simd_arg(0, "argument of reduction")) {
+                if (!is_int(simd_type->elem_type()) && !is_float(simd_type->elem_type()))
+                    error(map->arg(0), "mismatched types: expected simd vector of numbers but found '{}' as argument of reduction", simd_type);
+                else if (map->type() != simd_type->elem_type() && map->type()->is_known())
+                    error(map, "mismatched types: expected '{}' but found '{}' as result of reduction", simd_type->elem_type(), map->type());
+            }
+            return;
+        }
+        case Intrinsic_gather:
+        case Intrinsic_scatter: {
+            if (!num_args(intrinsic == Intrinsic_gather ? 2 : 3)) return;
+            auto elem = elem_type(0, intrinsic == Intrinsic_scatter);
+            auto index = simd_arg(1, "index vector");
+            if (index && !is_int(index->elem_type()))
+                error(map->arg(1), "mismatched types: expected simd vector of integers but found '{}' as index vector", index);
+            if (elem && index) {
+                if (intrinsic == Intrinsic_gather)
+                    expect_simd(map, elem, index->dim_type(), "result of 'gather'");
+                else
+                    expect_simd(map->arg(2), elem, index->dim_type(), "values of 'scatter'");
+            }
+            return;
+        }
+        case Intrinsic_masked_load:
+        case Intrinsic_masked_store: {
+            if (!num_args(3)) return;
+            auto elem = elem_type(0, intrinsic == Intrinsic_masked_store);
+            auto mask = simd_arg(1, "mask");
+            if (mask && !is_bool(mask->elem_type()))
+                error(map->arg(1), "mismatched types: expected simd vector of booleans but found '{}' as mask", mask);
+            if (elem && mask) {
+                expect_simd(map->arg(2), elem, mask->dim_type(), intrinsic == Intrinsic_masked_load ? "pass-through values of 'masked_load'" : "values of 'masked_store'");
+                if (intrinsic == Intrinsic_masked_load)
+                    expect_simd(map, elem, mask->dim_type(), "result of 'masked_load'");
+            }
+            return;
+        }
+        case Intrinsic_prefetch: {
+            if (!num_args(3)) return;
+            auto type = map->arg(0)->type();
+            if (!type->isa<PtrType>() && type->is_known() && !type->isa<TypeError>())
+                error(map->arg(0), "mismatched types: expected pointer type but found '{}' as first argument of 'prefetch'", type);
+            auto literal_arg = [&] (size_t i, const char* what, uint64_t max) {
+                auto literal = map->arg(i)->isa<LiteralExpr>();
+                if (!literal || !is_int(literal->type()))
+                    error(map->arg(i), "{} of 'prefetch' must be an integer literal", what);
+                else if (literal->get_u64() > max)
+                    error(map->arg(i), "{} of 'prefetch' must be between 0 and {}", what, max);
+            };
+            literal_arg(1, "read/write flag", 1);
+            literal_arg(2, "locality", 3);
+            return;
+        }
+        case Intrinsic_add_sat:
+        case Intrinsic_sub_sat:
+        case Intrinsic_add_overflow:
+        case Intrinsic_sub_overflow:
+        case Intrinsic_mul_overflow:
+        case Intrinsic_mulhi: {
+            if (!num_args(2)) return;
+            auto type = map->arg(0)->type();
+            auto simd_type = type->isa<SimdType>();
+            if (!is_int(simd_type ? simd_type->elem_type() : type)) {
+                if (type->is_known() && !type->isa<TypeError>())
+                    error(map->arg(0), "mismatched types: expected integer type or simd vector of integers but found '{}' as first argument of '{}'", type, map->lhs());
+                return;
+            }
+            auto rhs_type = map->arg(1)->type();
+            if (rhs_type != type && rhs_type->is_known() && !rhs_type->isa<TypeError>())
+                error(map->arg(1), "mismatched types: expected '{}' but found '{}' as second argument of '{}'", type, rhs_type, map->lhs());
+            if (!map->type()->is_known() || map->type()->isa<TypeError>())
+                return;
+            if (intrinsic == Intrinsic_add_overflow || intrinsic == Intrinsic_sub_overflow || intrinsic == Intrinsic_mul_overflow) {
+                // the result is the wrapped value and a flag per lane which tells whether it overflowed
+                auto tuple_type = map->type()->isa<TupleType>();
+                auto flags = tuple_type && tuple_type->num_ops() == 2 && tuple_type->op(0) == type ? tuple_type->op(1) : nullptr;
+                bool valid = flags && (simd_type ? flags->isa<SimdType>() && is_simd(flags, flags->as<SimdType>()->elem_type(), simd_type->dim_type())
+                                                   && is_bool(flags->as<SimdType>()->elem_type())
+                                                 : is_bool(flags));
+                if (!valid && simd_type)
+                    error(map, "mismatched types: expected '({}, simd[bool * {}])' but found '{}' as result of '{}'", type, simd_type->dim_type(), map->type(), map->lhs());
+                else if (!valid)
+                    error(map, "mismatched types: expected '({}, bool)' but found '{}' as result of '{}'", type, map->type(), map->lhs());
+            } else if (map->type() != type) {
+                error(map, "mismatched types: expected '{}' but found '{}' as result of '{}'", type, map->type(), map->lhs());
+            }
+            return;
+        }
+        case Intrinsic_atomic:
+            if (map->num_args() == 4) {
+                order_arg(3, "ordering", {2, 4, 5, 6, 7});
+                // the operation becomes part of the LLVM instruction along with the ordering
+                auto op = map->arg(0)->isa<LiteralExpr>();
+                if (!op || !is_int(op->type()))
+                    error(map->arg(0), "operation of '{}' must be an integer literal if an ordering is given", map->lhs());
+                else if (op->get_u64() > 10)
+                    error(map->arg(0), "invalid operation {} for '{}'", op->get_u64(), map->lhs());
+            }
+            return;
+        case Intrinsic_cmpxchg:
+        case Intrinsic_cmpxchg_weak: {
+            if (map->num_args() == 3) return;
+            if (!num_args(5)) return;
+            auto success = order_arg(3, "success ordering", {2, 4, 5, 6, 7});
+            auto failure = order_arg(4, "failure ordering", {2, 4, 7});
+            // the failure ordering only loads and mustn't be stronger than the success ordering
+            if (success != 0 && ((failure == 7 && success != 7) || (failure == 4 && (success == 2 || success == 5))))
+                error(map->arg(4), "failure ordering of '{}' is stronger than its success ordering", map->lhs());
+            return;
+        }
+        case Intrinsic_atomic_load:
+        case Intrinsic_atomic_store: {
+            bool store = intrinsic == Intrinsic_atomic_store;
+            if (!num_args(store ? 3 : 2)) return;
+            auto type = map->arg(0)->type();
+            auto ptr_type = type->isa<PtrType>();
+            if (!ptr_type || !(is_int(ptr_type->pointee()) || is_float(ptr_type->pointee()))) {
+                if (type->is_known() && !type->isa<TypeError>())
+                    error(map->arg(0), "mismatched types: expected pointer to integer or floating-point type but found '{}' as first argument of '{}'", type, map->lhs());
+            } else if (store) {
+                if (ptr_type->isa<BorrowedPtrType>() && !ptr_type->is_mut())
+                    error(map->arg(0), "mutable pointer required as first argument of 'atomic_store'");
+                if (map->arg(1)->type() != ptr_type->pointee() && map->arg(1)->type()->is_known())
+                    error(map->arg(1), "mismatched types: expected '{}' but found '{}' as value of 'atomic_store'", ptr_type->pointee(), map->arg(1)->type());
+            }
+            if (store)
+                order_arg(2, "ordering", {2, 5, 7});
+            else
+                order_arg(1, "ordering", {2, 4, 7});
+            return;
+        }
+        case Intrinsic_fence:
+            if (num_args(1))
+                order_arg(0, "ordering", {4, 5, 6, 7});
+            return;
+        case Intrinsic_store_nontemporal: {
+            if (!num_args(2)) return;
+            auto type = map->arg(0)->type();
+            auto ptr_type = type->isa<PtrType>();
+            if (!ptr_type || !(ptr_type->pointee()->isa<PrimType>() || ptr_type->pointee()->isa<SimdType>())) {
+                if (type->is_known() && !type->isa<TypeError>())
+                    error(map->arg(0), "mismatched types: expected pointer to primitive or simd type but found '{}' as first argument of 'store_nontemporal'", type);
+                return;
+            }
+            if (ptr_type->isa<BorrowedPtrType>() && !ptr_type->is_mut())
+                error(map->arg(0), "mutable pointer required as first argument of 'store_nontemporal'");
+            if (map->arg(1)->type() != ptr_type->pointee() && map->arg(1)->type()->is_known())
+                error(map->arg(1), "mismatched types: expected '{}' but found '{}' as value of 'store_nontemporal'", ptr_type->pointee(), map->arg(1)->type());
+            return;
+        }
+        default:
+            return;
+    }
 }
 
 void MapExpr::check(TypeSema& sema) const {
@@ -605,7 +1133,12 @@ void MapExpr::check(TypeSema& sema) const {
     if (ltype->isa<FnType>()) {
         if (!type()->is_known())
             error(this, "cannot infer type for function call");
-        return sema.check_call(lhs(), args());
+        sema.check_call(lhs(), args());
+        if (num_args() + 1 == ltype->as<FnType>()->num_params())
+            check_intrinsic(this, intrinsic(this));
+        if (auto fn_decl = callee(this))
+            check_noalias(this, fn_decl);
+        return;
     }
 
     if (ltype->isa<ArrayType>()) {
@@ -613,6 +1146,11 @@ void MapExpr::check(TypeSema& sema) const {
             sema.expect_int(arg(0), "for array subscript");
         else
             error(this, "too many array subscripts");
+    } else if (ltype->isa<SliceType>()) {
+        if (num_args() == 1)
+            sema.expect_int(arg(0), "for slice subscript");
+        else
+            error(this, "too many slice subscripts");
     } else if (ltype->isa<TupleType>()) {
         if (num_args() == 1) {
             sema.expect_int(arg(0), "for tuple subscript");
@@ -629,6 +1167,19 @@ void MapExpr::check(TypeSema& sema) const {
         error(this, "incorrect type for map expression");
 }
 
+void SliceExpr::check(TypeSema& sema) const {
+    auto ltype = unpack_ref_type(sema.check(lhs()));
+    sema.check(begin());
+    sema.check(end());
+    sema.expect_int(begin(), "begin of slice expression");
+    sema.expect_int(end(), "end of slice expression");
+
+    if (!type()->isa<SliceType>() && ltype->is_known() && !ltype->isa<TypeError>())
+        error(lhs(), "expected slice or pointer to array but found '{}' in slice expression", ltype);
+    else if (ltype->isa<PtrType>() && is_soa(ltype->as<PtrType>()->pointee()))
+        error(lhs(), "cannot slice a #[soa] array");
+}
+
 void TypeSema::check_call(const Expr* expr, ArrayRef<const Expr*> args) {
     auto fn_type = expr->type()->as<FnType>();
 
@@ -641,6 +1192,7 @@ void TypeSema::check_call(const Expr* expr, ArrayRef<const Expr*> args) {
 }
 
 void BlockExpr::check(TypeSema& sema) const {
+    check_attrs("block", {{"fast_math", 0}, {"reassoc", 0}, {"contract", 0}, {"nnan", 0}, {"ninf", 0}, {"arcp", 0}});
     THORIN_PUSH(sema.cur_block_, this);
     for (const auto& stmt : stmts())
         sema.check(stmt.get());
@@ -670,19 +1222,28 @@ inline bool is_match_complete(const MatchExpr* match) {
         Array<bool> covered(enum_decl->num_option_decls(), false);
         size_t num_covered = 0;
 
-        for (size_t i = 0, e = match->num_arms(); i != e; ++i) {
-            auto enum_ptrn = match->arm(i)->ptrn()->isa<EnumPtrn>();
-            if (!enum_ptrn) continue;
+        std::function<void(const Ptrn*)> cover = [&] (const Ptrn* ptrn) {
+            if (auto or_ptrn = ptrn->isa<OrPtrn>()) {
+                for (const auto& alt : or_ptrn->alts())
+                    cover(alt.get());
+                return;
+            }
+
+            auto enum_ptrn = ptrn->isa<EnumPtrn>();
+            if (!enum_ptrn) return;
             auto option_decl = enum_ptrn->path()->decl()->isa<OptionDecl>();
-            if (!option_decl || option_decl->enum_decl() != enum_decl) continue;
+            if (!option_decl || option_decl->enum_decl() != enum_decl) return;
 
             bool refutable = false;
             for (auto& arg : enum_ptrn->args()) refutable |= arg->is_refutable();
-            if (refutable) continue;
+            if (refutable) return;
 
             num_covered += covered[option_decl->index()] ? 0 : 1;
             covered[option_decl->index()] = true;
-        }
+        };
+
+        for (size_t i = 0, e = match->num_arms(); i != e; ++i)
+            cover(match->arm(i)->ptrn());
 
         if (num_covered == enum_decl->num_option_decls()) return true;
     }
@@ -712,6 +1273,8 @@ void MatchExpr::check(TypeSema& sema) const {
 }
 
 void WhileExpr::check(TypeSema& sema) const {
+    check_attrs("while loop", {{"unroll", 1}, {"no_unroll", 0}, {"vectorize", 1}, {"parallel", 0}});
+    check_loop_attrs(this, false);
     sema.check(cond());
     sema.expect_bool(cond(), "while-condition");
     sema.check(break_decl());
@@ -723,8 +1286,24 @@ void WhileExpr::check(TypeSema& sema) const {
 }
 
 void ForExpr::check(TypeSema& sema) const {
+    check_attrs("for loop", {{"unroll", 1}, {"no_unroll", 0}, {"vectorize", 1}, {"parallel", 0}, {"chunked", 1}, {"dynamic", 1}});
+    check_loop_attrs(this, true);
     auto forexpr = expr();
 
+    // scheduling of parallel loops
+    auto chunked = attr("chunked");
+    auto dynamic = attr("dynamic");
+    for (auto schedule : {chunked, dynamic}) {
+        if (schedule == nullptr)
+            continue;
+        if (schedule->num_args() == 1 && (schedule->arg(0) == 0 || schedule->arg(0) > uint64_t(std::numeric_limits<int32_t>::max())))
+            error(schedule, "chunk size must be between 1 and {}, got {}", std::numeric_limits<int32_t>::max(), schedule->arg(0));
+        if (!forexpr->isa<MapExpr>() || intrinsic(forexpr->as<MapExpr>()) != Intrinsic_parallel)
+            error(schedule, "attribute '{}' needs a loop over 'parallel'", schedule->symbol());
+    }
+    if (chunked && dynamic)
+        error(dynamic, "conflicting attributes 'chunked' and 'dynamic'");
+
     if (auto map = forexpr->isa<MapExpr>()) {
         auto ltype = sema.check(map->lhs());
         for (const auto& arg : map->args())
@@ -789,6 +1368,51 @@ void LiteralPtrn::check(TypeSema& sema) const {
         sema.expect_num(literal(), "literal pattern");
 }
 
+void RangePtrn::check(TypeSema& sema) const {
+    sema.check(lo());
+    sema.check(hi());
+    sema.expect_int(lo()->literal(), "lower bound of range pattern");
+    sema.expect_int(hi()->literal(), "upper bound of range pattern");
+    sema.expect_type(lo()->type(), hi(), "upper bound of range pattern");
+
+    if (is_int(lo()->type()) && lo()->type() == hi()->type()) {
+        auto lo_value = lo()->get_s64(), hi_value = hi()->get_s64();
+        if (is_signed(lo()->type()) ? lo_value > hi_value : uint64_t(lo_value) > uint64_t(hi_value))
+            error(this, "lower bound of range pattern exceeds its upper bound");
+    }
+}
+
+/// Returns the first variable bound by @p ptrn or @c nullptr if there is none.
+static const IdPtrn* find_binding(const Ptrn* ptrn) {
+    if (auto id_ptrn = ptrn->isa<IdPtrn>())
+        return id_ptrn->local()->symbol().is_anonymous() ? nullptr : id_ptrn;
+
+    const Ptrns* ptrns = nullptr;
+    if (auto tuple_ptrn = ptrn->isa<TuplePtrn>())
+        ptrns = &tuple_ptrn->elems();
+    else if (auto enum_ptrn = ptrn->isa<EnumPtrn>())
+        ptrns = &enum_ptrn->args();
+    else if (auto or_ptrn = ptrn->isa<OrPtrn>())
+        ptrns = &or_ptrn->alts();
+
+    if (ptrns) {
+        for (const auto& p : *ptrns) {
+            if (auto binding = find_binding(p.get()))
+                return binding;
+        }
+    }
+    return nullptr;
+}
+
+void OrPtrn::check(TypeSema& sema) const {
+    for (const auto& alt : alts()) {
+        sema.check(alt.get());
+        sema.expect_type(type(), alt.get(), "alternative of pattern");
+        if (auto binding = find_binding(alt.get()))
+            error(binding, "variable '{}' cannot be bound in an alternative of a pattern", binding->local()->symbol());
+    }
+}
+
 //------------------------------------------------------------------------------
 
 /*
@@ -0,0 +1,358 @@
+#include "impala/server.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace impala {
+
+//------------------------------------------------------------------------------
+
+/*
+ * wire format: every string is sent as its 32-bit length followed by its bytes
+ */
+
+static void write_all(int fd, const char* data, size_t size) {
+    while (size != 0) {
+        auto n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("cannot write to socket: ") + strerror(errno));
+        }
+        data += n;
+        size -= n;
+    }
+}
+
+static void read_all(int fd, char* data, size_t size) {
+    while (size != 0) {
+        auto n = ::read(fd, data, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            throw std::runtime_error("connection to compile server closed unexpectedly");
+        data += n;
+        size -= n;
+    }
+}
+
+static void send_u32(int fd, uint32_t u) { write_all(fd, reinterpret_cast<const char*>(&u), sizeof(u)); }
+static uint32_t recv_u32(int fd) {
+    uint32_t u;
+    read_all(fd, reinterpret_cast<char*>(&u), sizeof(u));
+    return u;
+}
+
+static void send_string(int fd, const std::string& s) {
+    send_u32(fd, s.size());
+    write_all(fd, s.data(), s.size());
+}
+
+static std::string recv_string(int fd) {
+    std::string s(recv_u32(fd), '\0');
+    if (!s.empty())
+        read_all(fd, &s[0], s.size());
+    return s;
+}
+
+static void send_request(int fd, const CompileRequest& request) {
+    send_string(fd, request.cwd);
+    send_u32(fd, request.args.size());
+    for (const auto& arg : request.args)
+        send_string(fd, arg);
+}
+
+static CompileRequest recv_request(int fd) {
+    CompileRequest request;
+    request.cwd = recv_string(fd);
+    request.args.resize(recv_u32(fd));
+    for (auto& arg : request.args)
+        arg = recv_string(fd);
+    return request;
+}
+
+static void send_response(int fd, const CompileResponse& response) {
+    send_u32(fd, uint32_t(response.status));
+    send_string(fd, response.out);
+    send_string(fd, response.err);
+}
+
+static CompileResponse recv_response(int fd) {
+    CompileResponse response;
+    response.status = int(recv_u32(fd));
+    response.out = recv_string(fd);
+    response.err = recv_string(fd);
+    return response;
+}
+
+static sockaddr_un address(const std::string& path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        throw std::invalid_argument("socket path '" + path + "' is too long");
+    std::strcpy(addr.sun_path, path.c_str());
+    return addr;
+}
+
+/// User id of the process at the other end of the connected socket @p fd.
+static bool peer_uid(int fd, uid_t& uid) {
+#ifdef SO_PEERCRED
+    ucred cred;
+    socklen_t size = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &size) != 0)
+        return false;
+    uid = cred.uid;
+    return true;
+#else
+    gid_t gid;
+    return getpeereid(fd, &uid, &gid) == 0;
+#endif
+}
+
+static bool same_user(int fd) {
+    uid_t uid;
+    return peer_uid(fd, uid) && uid == getuid();
+}
+
+/// Throws unless @p path is a directory which only the current user may access.
+static void check_private_dir(const std::string& path) {
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0)
+        throw std::runtime_error("cannot access '" + path + "': " + strerror(errno));
+    if (!S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & (S_IRWXG | S_IRWXO)) != 0)
+        throw std::runtime_error("'" + path + "' is not a directory which only the current user may access");
+}
+
+//------------------------------------------------------------------------------
+
+static bool is_serving = false;
+static bool is_worker = false;
+static pid_t worker_pid = 0;
+
+bool serving() { return is_serving; }
+
+static void flush_all() {
+    std::cout.flush();
+    std::cerr.flush();
+    fflush(stdout);
+    fflush(stderr);
+}
+
+std::string default_socket() {
+    std::string dir;
+    if (auto runtime_dir = std::getenv("XDG_RUNTIME_DIR")) {
+        dir = runtime_dir;
+    } else {
+        // a world-writable directory like /tmp would let others create or replace the socket
+        dir = "/tmp/impala-" + std::to_string(getuid());
+        if (mkdir(dir.c_str(), S_IRWXU) != 0 && errno != EEXIST)
+            throw std::runtime_error("cannot create '" + dir + "': " + strerror(errno));
+    }
+    check_private_dir(dir);
+    return dir + "/impala.sock";
+}
+
+bool fork_worker() {
+    if (!is_serving || is_worker)
+        return true;
+
+    flush_all();
+    auto pid = fork();
+    if (pid < 0)
+        throw std::runtime_error(std::string("cannot fork compile worker: ") + strerror(errno));
+    if (pid == 0) {
+        is_worker = true;
+        return true;
+    }
+    worker_pid = pid;
+    return false;
+}
+
+/**
+ * Redirects the file descriptor @p fd into an anonymous temporary file while alive.
+ * This also catches output that bypasses @c std::cout and @c std::cerr like LLVM's diagnostics.
+ * The file is opened for appending, so a forked worker and the server never overwrite each other's output.
+ */
+class Capture {
+public:
+    Capture(int fd)
+        : fd_(fd)
+    {
+        char name[] = "/tmp/impala-capture-XXXXXX";
+        file_ = mkstemp(name);
+        if (file_ < 0)
+            throw std::runtime_error(std::string("cannot create capture file: ") + strerror(errno));
+        ::unlink(name);
+        fcntl(file_, F_SETFL, O_APPEND);
+        saved_ = dup(fd_);
+        dup2(file_, fd_);
+    }
+    ~Capture() {
+        dup2(saved_, fd_);
+        close(saved_);
+        close(file_);
+    }
+
+    /// Everything written so far; call @p flush_all before.
+    std::string str() const {
+        std::string result;
+        char buf[4096];
+        for (off_t offset = 0;;) {
+            auto n = pread(file_, buf, sizeof(buf), offset);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return result;
+            result.append(buf, n);
+            offset += n;
+        }
+    }
+
+private:
+    int fd_;
+    int file_;
+    int saved_;
+};
+
+static CompileResponse handle(const CompileRequest& request, const CompileFn& compile) {
+    CompileResponse response;
+    if (chdir(request.cwd.c_str()) != 0) {
+        response.err = "cannot change to directory '" + request.cwd + "': " + strerror(errno) + "\n";
+        return response;
+    }
+
+    flush_all();
+    Capture out(STDOUT_FILENO), err(STDERR_FILENO);
+    response.status = compile(request.args);
+    flush_all();
+    response.out = out.str();
+    response.err = err.str();
+    return response;
+}
+
+int serve(const std::string& path, const CompileFn& compile) {
+    if (is_serving)
+        throw std::logic_error("already running as compile server");
+
+    auto addr = address(path);
+    // only replace a stale socket of our own - never some other file
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode) || st.st_uid != getuid())
+            throw std::runtime_error("refusing to replace '" + path + "' which is not a socket of the current user");
+        ::unlink(path.c_str());
+    }
+
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0)
+        throw std::runtime_error(std::string("cannot create socket: ") + strerror(errno));
+    auto mask = umask(S_IRWXG | S_IRWXO);
+    auto bound = bind(sock, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+    umask(mask);
+    if (!bound || listen(sock, SOMAXCONN) != 0) {
+        auto msg = std::string("cannot listen on '") + path + "': " + strerror(errno);
+        close(sock);
+        throw std::runtime_error(msg);
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    is_serving = true;
+
+    for (bool running = true; running;) {
+        int conn = accept(sock, nullptr, nullptr);
+        if (conn < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("cannot accept connection: ") + strerror(errno));
+        }
+        // requests run with the permissions of the server
+        if (!same_user(conn)) {
+            std::cerr << "rejected connection from another user" << std::endl;
+            close(conn);
+            continue;
+        }
+
+        try {
+            auto request = recv_request(conn);
+            CompileResponse response;
+            if (request.args.size() == 2 && request.args[1] == shutdown_flag) {
+                response.status = EXIT_SUCCESS;
+                running = false;
+            } else {
+                worker_pid = 0;
+                response = handle(request, compile);
+
+                if (is_worker) {
+                    send_response(conn, response);
+                    _exit(EXIT_SUCCESS);
+                }
+
+                if (worker_pid != 0) {
+                    // the worker answers itself unless it died on the way
+                    int status;
+                    while (waitpid(worker_pid, &status, 0) < 0 && errno == EINTR) {}
+                    if (!WIFSIGNALED(status)) {
+                        close(conn);
+                        continue;
+                    }
+                    response.status = EXIT_FAILURE;
+                    response.err += "compile worker terminated by signal " + std::to_string(WTERMSIG(status)) + "\n";
+                }
+            }
+            send_response(conn, response);
+        } catch (const std::exception& e) {
+            if (is_worker)
+                _exit(EXIT_FAILURE);
+            std::cerr << e.what() << std::endl;
+        }
+        close(conn);
+    }
+
+    close(sock);
+    ::unlink(path.c_str());
+    is_serving = false;
+    return EXIT_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+
+bool request(const std::string& path, const CompileRequest& request, CompileResponse& response) {
+    auto addr = address(path);
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0)
+        return false;
+    if (connect(sock, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(sock);
+        return false;
+    }
+    if (!same_user(sock)) {
+        close(sock);
+        throw std::runtime_error("compile server at '" + path + "' belongs to another user");
+    }
+
+    try {
+        send_request(sock, request);
+        response = recv_response(sock);
+    } catch (...) {
+        close(sock);
+        throw;
+    }
+    close(sock);
+    return true;
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef IMPALA_SERVER_H
+#define IMPALA_SERVER_H
+
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace impala {
+
+/// Command line and working directory of a single compile request.
+struct CompileRequest {
+    std::string cwd;
+    std::vector<std::string> args; ///< Includes the program name as first argument.
+};
+
+/// Everything a compile request would have printed and its exit code.
+struct CompileResponse {
+    int status = EXIT_FAILURE;
+    std::string out;
+    std::string err;
+};
+
+typedef std::function<int(const std::vector<std::string>&)> CompileFn;
+
+/// Sending a request with this single argument stops the server.
+static const char* const shutdown_flag = "-shutdown";
+
+/**
+ * Default socket used by the client if @c IMPALA_SERVER is not set.
+ * It lives in @c XDG_RUNTIME_DIR or else in a directory of the current user in @c /tmp, which is created if needed.
+ */
+std::string default_socket();
+
+/**
+ * Listens on the Unix socket @p path and runs @p compile for each incoming request.
+ * Requests are served one at a time: everything written to stdout and stderr is captured and
+ * sent back to the client together with the return value of @p compile.
+ * Only the current user may connect; an existing file at @p path is only replaced if it is a socket of this user.
+ */
+int serve(const std::string& path, const CompileFn& compile);
+
+/// Are we running as compile server?
+bool serving();
+
+/**
+ * Forks a worker that finishes the current request.
+ * State that is modified during code generation must not leak into the resident server.
+ * @return true in the worker (or if not serving), false in the server which must return immediately.
+ */
+bool fork_worker();
+
+/// Sends @p request to the server listening on @p path; returns false if there is no such server and throws if it belongs to another user.
+bool request(const std::string& path, const CompileRequest& request, CompileResponse& response);
+
+}
+
+#endif
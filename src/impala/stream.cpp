@@ -15,14 +15,24 @@ std::ostream& ErrorASTType::stream(std::ostream& os) const { return os << "<erro
 
 std::ostream& PtrASTType::stream(std::ostream& os) const {
     os << prefix();
-    if (addr_space() != 0)
+    if (addr_space() != 0 && align() != 0)
+        os << '[' << addr_space() << ", align " << align() << ']';
+    else if (addr_space() != 0)
         os << '[' << addr_space() << ']';
+    else if (align() != 0)
+        os << "[align " << align() << ']';
     return os << referenced_ast_type();
 }
 
 std::ostream& DefiniteArrayASTType::stream(std::ostream& os) const { return streamf(os, "[{} * {}]", elem_ast_type(), dim()); }
 std::ostream& IndefiniteArrayASTType::stream(std::ostream& os) const { return streamf(os, "[{}]", elem_ast_type()); }
 std::ostream& SimdASTType::stream(std::ostream& os) const { return streamf(os, "simd[{} * {}]", elem_ast_type(), size()); }
+std::ostream& SliceASTType::stream(std::ostream& os) const {
+    os << "slice[" << (is_mut() ? "mut " : "");
+    if (addr_space() != 0)
+        os << '[' << addr_space() << "] ";
+    return os << elem_ast_type() << ']';
+}
 
 std::ostream& TupleASTType::stream(std::ostream& os) const {
     return stream_list(os, ast_type_args(), [&](const auto& ast_type) { os << ast_type.get(); }, "(", ")");
@@ -57,6 +67,8 @@ std::ostream& PrimASTType::stream(std::ostream& os) const {
     }
 }
 
+std::ostream& ConstASTType::stream(std::ostream& os) const { return os << value(); }
+
 std::ostream& Typeof::stream(std::ostream& os) const {
     return streamf(os, "typeof({})", expr());
 }
@@ -77,10 +89,31 @@ std::ostream& Path::stream(std::ostream& os) const {
  */
 
 std::ostream& ASTTypeParam::stream(std::ostream& os) const {
+    if (is_const())
+        return os << symbol() << ": const";
     os << symbol() << (bounds_.empty() ? "" : ": ");
     return stream_list(os, bounds(), [&](const auto& type) { os << type.get(); }, "", "", " + ");
 }
 
+std::ostream& Attr::stream(std::ostream& os) const {
+    os << symbol();
+    if (num_args() != 0 || num_strs() != 0) {
+        os << '(';
+        stream_list(os, args(), [&](uint64_t arg) { os << arg; }, "", "");
+        if (num_args() != 0 && num_strs() != 0)
+            os << ", ";
+        stream_list(os, strs(), [&](const std::string& str) { os << '"' << str << '"'; }, "", "");
+        os << ')';
+    }
+    return os;
+}
+
+std::ostream& AttrList::stream_attrs(std::ostream& os) const {
+    if (!attrs().empty())
+        stream_list(os, attrs(), [&](const auto& attr) { os << attr.get(); }, "#[", "] ");
+    return os;
+}
+
 std::ostream& ASTTypeParamList::stream_ast_type_params(std::ostream& os) const {
     if (!ast_type_params().empty())
         stream_list(os, ast_type_params(), [&](const auto& ast_type_param) { os << ast_type_param.get(); }, "[", "]");
@@ -112,7 +145,7 @@ std::ostream& Param::stream(std::ostream& os) const {
     if (pe_expr())
         os << '@' << pe_expr() << ' ';
     if (!is_anonymous())
-        os << (is_mut() ? "mut " : "") << symbol() <<
+        os << (is_noalias() ? "noalias " : "") << (is_mut() ? "mut " : "") << symbol() <<
             ((ast_type() || type()) ? ": " : "");
 
     if (type())
@@ -145,6 +178,7 @@ std::ostream& ExternBlock::stream(std::ostream& os) const {
 }
 
 std::ostream& FnDecl::stream(std::ostream& os) const {
+    stream_attrs(os);
     if (is_extern())
         os << "extern ";
     os << "fn ";
@@ -179,7 +213,7 @@ std::ostream& FnDecl::stream(std::ostream& os) const {
 }
 
 std::ostream& FieldDecl::stream(std::ostream& os) const {
-    return streamf(os, "{}{}: {}", visibility().str(), symbol(), ast_type());
+    return streamf(stream_attrs(os), "{}{}: {}", visibility().str(), symbol(), ast_type());
 }
 
 std::ostream& OptionDecl::stream(std::ostream& os) const {
@@ -199,7 +233,7 @@ std::ostream& StaticItem::stream(std::ostream& os) const {
 }
 
 std::ostream& StructDecl::stream(std::ostream& os) const {
-    stream_ast_type_params(streamf(os, "{}struct {}", visibility().str(), symbol())) << " {" << up << endl;
+    stream_ast_type_params(streamf(stream_attrs(os), "{}struct {}", visibility().str(), symbol())) << " {" << up << endl;
     return stream_list(os, field_decls(), [&](const auto& field) { os << field.get(); }, "", "", ",", true) << down << endl << "}";
 }
 
@@ -241,7 +275,7 @@ std::ostream& ImplItem::stream(std::ostream& os) const {
  */
 
 std::ostream& BlockExpr::stream(std::ostream& os) const {
-    os << '{';
+    stream_attrs(os) << '{';
     if (empty())
         return os << endl << '}';
 
@@ -303,6 +337,13 @@ std::ostream& IndefiniteArrayExpr::stream(std::ostream& os) const {
     return streamf(os, "[{}: {}]", dim(), elem_ast_type());
 }
 
+std::ostream& IncludeBytesExpr::stream(std::ostream& os) const {
+    os << "include_bytes";
+    if (elem_ast_type())
+        streamf(os, "[{}]", elem_ast_type());
+    return streamf(os, "(\"{}\")", path());
+}
+
 std::ostream& SimdExpr::stream(std::ostream& os) const {
     return stream_list(os, args(), [&](const auto& expr) { os << expr.get(); }, "simd[", "]");
 }
@@ -440,9 +481,22 @@ std::ostream& MapExpr::stream(std::ostream& os) const {
     return os;
 }
 
+std::ostream& SliceExpr::stream(std::ostream& os) const {
+    Prec l = Prec::Unary;
+    Prec old = prec;
+    bool paren = !fancy() || prec > l;
+    if (paren) os << "(";
+
+    prec = l;
+    streamf(os, "{}({}..{})", lhs(), begin(), end());
+    prec = old;
+    if (paren) os << ")";
+    return os;
+}
+
 std::ostream& FnExpr::stream(std::ostream& os) const {
     bool has_return_type = !params().empty() && params().back()->symbol() == "return";
-    os << '|';
+    stream_attrs(os) << '|';
     stream_params(os, has_return_type);
     os << "| ";
 
@@ -490,11 +544,11 @@ std::ostream& MatchExpr::stream(std::ostream& os) const {
 }
 
 std::ostream& WhileExpr::stream(std::ostream& os) const {
-    return streamf(os, "while {} {}", cond(), body());
+    return streamf(stream_attrs(os), "while {} {}", cond(), body());
 }
 
 std::ostream& ForExpr::stream(std::ostream& os) const {
-    stream_list(os << "for ", fn_expr()->params().skip_back(), [&](const auto& param) { os << param.get(); }) << " in ";
+    stream_list(stream_attrs(os) << "for ", fn_expr()->params().skip_back(), [&](const auto& param) { os << param.get(); }) << " in ";
     return os << expr() << ' ' << fn_expr()->body();
 }
 
@@ -520,7 +574,15 @@ std::ostream& EnumPtrn::stream(std::ostream& os) const {
 }
 
 std::ostream& LiteralPtrn::stream(std::ostream& os) const {
-    return os << literal();
+    return os << (has_minus() ? "-" : "") << literal();
+}
+
+std::ostream& RangePtrn::stream(std::ostream& os) const {
+    return os << lo() << ".." << hi();
+}
+
+std::ostream& OrPtrn::stream(std::ostream& os) const {
+    return stream_list(os, alts(), [&] (const auto& alt) { os << alt.get(); }, "", "", " | ");
 }
 
 /*
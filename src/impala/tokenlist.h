@@ -104,6 +104,9 @@ IMPALA_KEY(TYPEDEF,   "type")
 IMPALA_KEY(TYPEOF,    "typeof")
 IMPALA_KEY(WHILE,     "while")
 IMPALA_KEY(SIMD,      "simd")
+IMPALA_KEY(INCLUDE_BYTES, "include_bytes")
+IMPALA_KEY(CONST,     "const")
+IMPALA_KEY(SLICE,     "slice")
 
 #undef IMPALA_KEY
 
@@ -124,6 +127,7 @@ IMPALA_MISC(COLON,        ":")
 IMPALA_MISC(DOUBLE_COLON, "::")
 IMPALA_MISC(COMMA,        ",")
 IMPALA_MISC(DOTDOT,       "..")
+IMPALA_MISC(HASH,         "#")
 
 #undef IMPALA_MISC
 
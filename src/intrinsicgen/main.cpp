@@ -1,5 +1,10 @@
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Intrinsics.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/LLVMContext.h>
@@ -17,8 +22,14 @@ static const char * const IntrinsicNameTable[] = {
 };
 
 const impala::Type* llvm2impala(impala::TypeTable&, llvm::Type*);
+llvm::Type* parse_type(llvm::LLVMContext&, const std::string&);
+int num_overloaded_types(llvm::Intrinsic::ID, llvm::Intrinsic::IITDescriptor::ArgKind&);
+bool matches(llvm::Intrinsic::IITDescriptor::ArgKind, llvm::Type*);
+bool is_valid(llvm::Intrinsic::ID, llvm::Type*);
 
-int main() {
+// usage: intrinsicgen [types...]
+// overloaded intrinsics are instantiated for the given types, e.g. 'f32' or 'f32x8' for simd[f32 * 8]
+int main(int argc, char** argv) {
     impala::init();
     std::unique_ptr<impala::TypeTable> typetable;
 
@@ -28,6 +39,34 @@ int main() {
     llvm::LLVMContext context;
     int num = llvm::Intrinsic::num_intrinsics - 1;
 
+    std::vector<std::string> type_names(argv + 1, argv + argc);
+    if (type_names.empty())
+        type_names = { "i8", "i16", "i32", "i64", "f32", "f64", "i32x4", "i32x8", "f32x4", "f32x8", "f64x2", "f64x4" };
+    std::vector<std::pair<std::string, llvm::Type*>> types;
+    for (const auto& type_name : type_names) {
+        auto type = parse_type(context, type_name);
+        if (type == nullptr) {
+            std::cerr << "invalid type '" << type_name << "'; expected e.g. 'f32' or 'i16x8'" << std::endl;
+            return EXIT_FAILURE;
+        }
+        types.emplace_back(type_name, type);
+    }
+
+    auto print_fn = [&] (const std::string& llvm_name, const std::string& name, const impala::Type* itype) {
+        std::cout << thorin::endl;
+        auto fn = itype->as<impala::FnType>();
+        std::cout << "fn \"" << llvm_name << "\" " << name << "(";
+        for (size_t i = 0, e = fn->num_params()-1; i != e; ++i) {
+            std::cout << fn->param(i);
+            if (i != e-1)
+                std::cout << ", ";
+        }
+        if (fn->return_type()->isa<impala::NoRetType>())
+            std::cout << ") -> !;";
+        else
+            std::cout << ") -> " << fn->return_type() << ';';
+    };
+
     std::cout << "extern \"device\" {" << thorin::up;
     for (int i = 1; i != num; ++i) {
         auto id = (llvm::Intrinsic::ID) i;
@@ -46,29 +85,123 @@ int main() {
         std::transform(name.begin(), name.end(), name.begin(), [] (char c) { return c == '.' ? '_' : c; });
 
         if (llvm::Intrinsic::isOverloaded(id)) {
-            std::cout << thorin::endl;
-            std::cout << "// fn \"" << llvm_name << "\" " << name;
-            std::cout << " (...) -> (...); // is overloaded";
-        } else {
-            if (auto itype = llvm2impala(*typetable, llvm::Intrinsic::getType(context, id))) {
-                std::cout << thorin::endl;
-                auto fn = itype->as<impala::FnType>();
-                std::cout << "fn \"" << llvm_name << "\" " << name << "(";
-                for (size_t i = 0, e = fn->num_params()-1; i != e; ++i) {
-                    std::cout << fn->param(i);
-                    if (i != e-1)
-                        std::cout << ", ";
+            // instantiate intrinsics with a single overloaded type, e.g. "llvm.fma.v8f32" as fma_f32x8
+            bool instantiated = false;
+            auto kind = llvm::Intrinsic::IITDescriptor::AK_Any;
+            if (num_overloaded_types(id, kind) == 1) {
+                for (const auto& type : types) {
+                    if (!matches(kind, type.second) || !is_valid(id, type.second))
+                        continue;
+                    if (auto itype = llvm2impala(*typetable, llvm::Intrinsic::getType(context, id, type.second))) {
+                        print_fn(llvm::Intrinsic::getName(id, type.second), name + '_' + type.first, itype);
+                        instantiated = true;
+                    }
                 }
-                if (fn->return_type()->isa<impala::NoRetType>())
-                    std::cout << ") -> !;";
-                else
-                    std::cout << ") -> " << fn->return_type() << ';';
             }
+
+            if (!instantiated) {
+                std::cout << thorin::endl;
+                std::cout << "// fn \"" << llvm_name << "\" " << name;
+                std::cout << " (...) -> (...); // is overloaded";
+            }
+        } else {
+            if (auto itype = llvm2impala(*typetable, llvm::Intrinsic::getType(context, id)))
+                print_fn(llvm_name, name, itype);
         }
     }
     std::cout << thorin::down << thorin::endl << '}' << thorin::endl;
 }
 
+llvm::Type* parse_type(llvm::LLVMContext& context, const std::string& name) {
+    auto x = name.find('x');
+    auto scalar = name.substr(0, x);
+    llvm::Type* type = nullptr;
+    if      (scalar == "f16") type = llvm::Type::getHalfTy(context);
+    else if (scalar == "f32") type = llvm::Type::getFloatTy(context);
+    else if (scalar == "f64") type = llvm::Type::getDoubleTy(context);
+    else if (scalar == "i8" || scalar == "i16" || scalar == "i32" || scalar == "i64")
+        type = llvm::IntegerType::get(context, std::stoi(scalar.substr(1)));
+    else
+        return nullptr;
+
+    if (x == std::string::npos)
+        return type;
+    auto lanes = name.substr(x + 1);
+    if (lanes.empty() || lanes.find_first_not_of("0123456789") != std::string::npos || std::stoul(lanes) == 0)
+        return nullptr;
+    return llvm::VectorType::get(type, std::stoul(lanes));
+}
+
+// number of types the intrinsic is overloaded on; kind receives the constraint of the first one
+int num_overloaded_types(llvm::Intrinsic::ID id, llvm::Intrinsic::IITDescriptor::ArgKind& kind) {
+    llvm::SmallVector<llvm::Intrinsic::IITDescriptor, 8> table;
+    llvm::Intrinsic::getIntrinsicInfoTableEntries(id, table);
+    int num = 0;
+    for (const auto& descriptor : table) {
+        switch (descriptor.Kind) {
+            case llvm::Intrinsic::IITDescriptor::Argument: {
+                // matching types refer to an earlier argument - only the first occurrence introduces a type
+                int number = descriptor.getArgumentNumber();
+                if (number >= num) {
+                    if (number == 0)
+                        kind = descriptor.getArgumentKind();
+                    num = number + 1;
+                }
+                break;
+            }
+            // vectors of pointers are overloaded on their own
+            case llvm::Intrinsic::IITDescriptor::VecOfAnyPtrsToElt:
+                ++num;
+                break;
+            default:
+                break;
+        }
+    }
+    return num;
+}
+
+bool matches(llvm::Intrinsic::IITDescriptor::ArgKind kind, llvm::Type* type) {
+    switch (kind) {
+        case llvm::Intrinsic::IITDescriptor::AK_Any:        return true;
+        case llvm::Intrinsic::IITDescriptor::AK_AnyInteger: return type->isIntOrIntVectorTy();
+        case llvm::Intrinsic::IITDescriptor::AK_AnyFloat:   return type->isFPOrFPVectorTy();
+        case llvm::Intrinsic::IITDescriptor::AK_AnyVector:  return type->isVectorTy();
+        default:                                            return false;
+    }
+}
+
+// the other constraints of the table entry on the overloaded type, and those only the verifier checks:
+// e.g. llvm.bswap.i8 matches any-integer but bswap needs an even number of bytes
+bool is_valid(llvm::Intrinsic::ID id, llvm::Type* type) {
+    llvm::SmallVector<llvm::Intrinsic::IITDescriptor, 8> table;
+    llvm::Intrinsic::getIntrinsicInfoTableEntries(id, table);
+    for (const auto& descriptor : table) {
+        switch (descriptor.Kind) {
+            // integers or vectors with twice or half as wide elements
+            case llvm::Intrinsic::IITDescriptor::ExtendArgument:
+                if (!type->isIntegerTy() && !type->isVectorTy())
+                    return false;
+                break;
+            case llvm::Intrinsic::IITDescriptor::TruncArgument:
+                if ((!type->isIntegerTy() && !type->isVectorTy()) || type->getScalarSizeInBits() % 2 != 0)
+                    return false;
+                break;
+            // vectors with half as many elements
+            case llvm::Intrinsic::IITDescriptor::HalfVecArgument:
+                if (!type->isVectorTy() || type->getVectorNumElements() % 2 != 0)
+                    return false;
+                break;
+            default:
+                break;
+        }
+    }
+
+    switch (id) {
+        case llvm::Intrinsic::bswap: return type->getScalarSizeInBits() % 16 == 0;
+        default:                     return true;
+    }
+}
+
 const impala::Type* llvm2impala(impala::TypeTable& tt, llvm::Type* type) {
     if (auto int_type = llvm::dyn_cast<llvm::IntegerType>(type)) {
         switch (int_type->getBitWidth()) {
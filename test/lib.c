@@ -1,5 +1,9 @@
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/sysinfo.h>
+#include <time.h>
 
 void print_char(char c) {
    printf("%c\n", (int)c);
@@ -97,7 +101,212 @@ void impala_memmove(char* dest, const char* src, int size) {
     __builtin_memmove(dest, src, size);
 }
 
+// timing of benchmarks - printed to stderr so that the output can still be compared
+long long anydsl_get_micro_time() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+void print_time(const char* what, int n, long long us) {
+    fprintf(stderr, "%s %d: %.3f ms\n", what, n, us / 1000.0);
+}
+
 // pe_known
 int forty_two() {
     return 42;
 }
+
+// parallel runtime: thorin lowers parallel/spawn/sync to the functions below
+
+#define MAX_THREADS 256
+
+// set in threads which currently run iterations of a parallel loop
+static __thread int in_parallel = 0;
+
+// iterations [begin, end) owned by one thread of the pool
+typedef struct {
+    pthread_mutex_t lock;
+    int64_t begin, end;
+    char pad[64];
+} Range;
+
+static struct {
+    pthread_mutex_t job_lock; // one parallel loop at a time
+    pthread_mutex_t lock;     // guards the fields below up to ranges
+    pthread_cond_t wake, done;
+    int num_workers;          // threads of the pool besides the thread starting a loop
+    uint64_t generation;      // incremented for each loop
+    int num_threads;
+    int pending;              // workers which still take part in the current loop
+
+    void (*fun)(void*, int32_t, int32_t);
+    void* args;
+    int64_t chunk;
+    Range ranges[MAX_THREADS];
+} pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+// takes the next chunk of the own range
+static int take(int id, int64_t* begin, int64_t* end) {
+    Range* range = &pool.ranges[id];
+    pthread_mutex_lock(&range->lock);
+    int found = range->begin < range->end;
+    if (found) {
+        *begin = range->begin;
+        *end = range->end - range->begin > pool.chunk ? range->begin + pool.chunk : range->end;
+        range->begin = *end;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return found;
+}
+
+// moves the upper half of the range of another thread to the own range
+static int steal(int id) {
+    for (int i = 1; i != pool.num_threads; ++i) {
+        Range* victim = &pool.ranges[(id + i) % pool.num_threads];
+        pthread_mutex_lock(&victim->lock);
+        int64_t left = victim->end - victim->begin;
+        int64_t num = left > pool.chunk ? left / 2 : left;
+        int64_t end = victim->end;
+        victim->end -= num;
+        pthread_mutex_unlock(&victim->lock);
+        if (num > 0) {
+            Range* range = &pool.ranges[id];
+            pthread_mutex_lock(&range->lock);
+            range->begin = end - num;
+            range->end = end;
+            pthread_mutex_unlock(&range->lock);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void run_iterations(int id) {
+    int64_t begin, end;
+    in_parallel = 1;
+    while (take(id, &begin, &end) || (steal(id) && take(id, &begin, &end)))
+        pool.fun(pool.args, (int32_t)begin, (int32_t)end);
+    in_parallel = 0;
+}
+
+static void* worker(void* arg) {
+    int id = (int)(intptr_t)arg;
+    uint64_t generation = 0;
+    pthread_mutex_lock(&pool.lock);
+    while (1) {
+        while (pool.generation == generation)
+            pthread_cond_wait(&pool.wake, &pool.lock);
+        generation = pool.generation;
+        if (id >= pool.num_threads)
+            continue;
+        pthread_mutex_unlock(&pool.lock);
+        run_iterations(id);
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.pending == 0)
+            pthread_cond_signal(&pool.done);
+    }
+    return NULL;
+}
+
+void anydsl_parallel_for(int32_t num_threads, int32_t lower, int32_t upper, void* args, void* fun) {
+    void (*fun_ptr)(void*, int32_t, int32_t) = (void (*)(void*, int32_t, int32_t))fun;
+
+    if (lower >= upper)
+        return;
+    if (num_threads <= 0)
+        num_threads = get_nprocs();
+    if (num_threads > MAX_THREADS)
+        num_threads = MAX_THREADS;
+    if (num_threads > upper - (int64_t)lower)
+        num_threads = (int32_t)(upper - (int64_t)lower);
+    // nested loops run sequentially in the thread which encounters them
+    if (num_threads <= 1 || in_parallel) {
+        fun_ptr(args, lower, upper);
+        return;
+    }
+
+    pthread_mutex_lock(&pool.job_lock);
+    pthread_mutex_lock(&pool.lock);
+    for (; pool.num_workers < num_threads - 1; ++pool.num_workers) {
+        pthread_t thread;
+        pthread_mutex_init(&pool.ranges[pool.num_workers + 1].lock, NULL);
+        if (pool.num_workers == 0)
+            pthread_mutex_init(&pool.ranges[0].lock, NULL);
+        pthread_create(&thread, NULL, worker, (void*)(intptr_t)(pool.num_workers + 1));
+        pthread_detach(thread);
+    }
+
+    int64_t size = upper - (int64_t)lower;
+    pool.fun = fun_ptr;
+    pool.args = args;
+    pool.num_threads = num_threads;
+    // split the own block into a few chunks so that others can steal parts of it
+    // #[chunked(N)] and #[dynamic(N)] loops arrive here with one iteration per chunk of N - see CodeGen::schedule_parallel
+    pool.chunk = size / (4 * num_threads) > 0 ? size / (4 * num_threads) : 1;
+    for (int i = 0; i != num_threads; ++i) {
+        pool.ranges[i].begin = lower + size * i / num_threads;
+        pool.ranges[i].end   = lower + size * (i + 1) / num_threads;
+    }
+    pool.pending = num_threads - 1;
+    ++pool.generation;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+
+    run_iterations(0);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.pending != 0)
+        pthread_cond_wait(&pool.done, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+    pthread_mutex_unlock(&pool.job_lock);
+}
+
+typedef struct {
+    pthread_t thread;
+    void* args;
+    void (*fun)(void*);
+} Task;
+
+static pthread_mutex_t tasks_lock = PTHREAD_MUTEX_INITIALIZER;
+static Task* tasks[MAX_THREADS];
+
+static void* run_task(void* arg) {
+    Task* task = (Task*)arg;
+    task->fun(task->args);
+    return NULL;
+}
+
+int32_t anydsl_spawn_thread(void* args, void* fun) {
+    Task* task = (Task*)malloc(sizeof(Task));
+    task->args = args;
+    task->fun = (void (*)(void*))fun;
+    pthread_mutex_lock(&tasks_lock);
+    int32_t id = 0;
+    while (id != MAX_THREADS && tasks[id] != NULL)
+        ++id;
+    if (id == MAX_THREADS) {
+        fprintf(stderr, "too many spawned threads\n");
+        exit(EXIT_FAILURE);
+    }
+    tasks[id] = task;
+    // create the thread before a sync can see the task
+    pthread_create(&task->thread, NULL, run_task, task);
+    pthread_mutex_unlock(&tasks_lock);
+    return id;
+}
+
+void anydsl_sync_thread(int32_t id) {
+    // take the task out right away so that a second sync of the same id is reported as well
+    pthread_mutex_lock(&tasks_lock);
+    Task* task = id >= 0 && id < MAX_THREADS ? tasks[id] : NULL;
+    if (task != NULL)
+        tasks[id] = NULL;
+    pthread_mutex_unlock(&tasks_lock);
+    if (task == NULL) {
+        fprintf(stderr, "sync of unknown or already synced thread %d\n", id);
+        exit(EXIT_FAILURE);
+    }
+    pthread_join(task->thread, NULL);
+    free(task);
+}
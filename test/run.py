@@ -23,9 +23,10 @@ RUN_FAILED = 5
 RUN_TIMEOUT = 6
 OUTPUT_DIFFER = 7
 LOG_DIFFER = 8
+IR_DIFFER = 9
 
 POSITIVE = [PASSED]
-NEGATIVE = [CLANG_FAILED, IMPALA_FAILED, RUN_FAILED, OUTPUT_DIFFER, LOG_DIFFER]
+NEGATIVE = [CLANG_FAILED, IMPALA_FAILED, RUN_FAILED, OUTPUT_DIFFER, LOG_DIFFER, IR_DIFFER]
 TIMEOUT = [CLANG_TIMEOUT, IMPALA_TIMEOUT, RUN_TIMEOUT]
 
 class test:
@@ -117,6 +118,11 @@ def is_broken(X):
             return True, res
     return False, X
 
+def is_trap(X):
+    if 'trap' in X:
+        return True, [x for x in X if x != 'trap']
+    return False, X
+
 def give_categorie(categories, file):
     line = read_first_line(file)
     if line == None:
@@ -165,15 +171,30 @@ def compare_files(a, b): # True if equal, false otherwise
     else:
         return True
 
+def missing_ir(ll, ir): # the first line of ir which the emitted LLVM module ll lacks, None if it has all of them
+    if not os.path.isfile(ir):
+        return None
+    with open(ll) as ll_file:
+        code = ll_file.read()
+    with open(ir) as ir_file:
+        for line in ir_file:
+            line = line.strip()
+            if line != '' and line not in code:
+                return line
+    return None
+
 def split_arguments(arguments):
+    impala_args = []
     clang_args = []
     exec_args = []
     for argument in arguments:
-        if argument[0] == '-':
+        if argument[:2] == '--':
+            impala_args.append(argument)
+        elif argument[0] == '-':
             clang_args.append(argument)
         else:
             exec_args.append(argument[1:-1])
-    return clang_args, exec_args
+    return impala_args, clang_args, exec_args
 
 def analyze_returncode(returncode):
     if returncode < 0:
@@ -203,13 +224,15 @@ def run_tests():
                 orig_in     = test_path[:-7] + '.in'
                 orig_out    = test_path[:-7] + '.out'
                 orig_log    = test_path[:-7] + '.log'
+                orig_ir     = test_path[:-7] + '.ir'
                 error      = '\n---> '
 
-                clang_args, exec_args = split_arguments(arguments)
+                impala_args, clang_args, exec_args = split_arguments(arguments)
                 tmp_log_file = open(tmp_log, 'w')
 
                 # invoke impala
                 cmd_impala = [args.impala,orig_impala, '-emit-llvm', '-O2']
+                cmd_impala.extend(impala_args)
 
                 try:
                     p = subprocess.run(cmd_impala, stderr=tmp_log_file, stdout=tmp_log_file, timeout=args.impala_timeout)
@@ -225,9 +248,15 @@ def run_tests():
                     error += 'impala ' + msg
                     return (IMPALA_FAILED, error)
 
+                # the emitted LLVM module has to contain every line of the .ir file
+                missing = missing_ir(tmp_ll, orig_ir)
+                if missing != None:
+                    error += 'emitted LLVM module lacks: ' + missing
+                    return (IR_DIFFER, error)
+
                 # invoke clang
                 try:
-                    cmd_clang = [args.clang, tmp_ll, 'lib.c', '-o', tmp_exe]
+                    cmd_clang = [args.clang, tmp_ll, 'lib.c', '-pthread', '-o', tmp_exe]
                     cmd_clang.extend(clang_args)
                     p = subprocess.run(cmd_clang, stderr=tmp_log_file, stdout=tmp_log_file, timeout=args.clang_timeout)
                 except subprocess.TimeoutExpired as timeout:
@@ -258,10 +287,16 @@ def run_tests():
                     return (RUN_FAILED, error)
                 tmp_out_file.close()
 
-                (passed, msg) = analyze_returncode(p.returncode)
-                if not passed:
-                    error += 'execution ' + msg
-                    return (RUN_FAILED, error)
+                # tests marked with 'trap' have to be terminated by a signal
+                if trap:
+                    if p.returncode >= 0:
+                        error += 'execution was expected to trap but returned exit code {}'.format(p.returncode)
+                        return (RUN_FAILED, error)
+                else:
+                    (passed, msg) = analyze_returncode(p.returncode)
+                    if not passed:
+                        error += 'execution ' + msg
+                        return (RUN_FAILED, error)
 
                 # log file
                 if (args.logfile):
@@ -295,6 +330,7 @@ def run_tests():
             if (not args.broken) and broken:
                 return
 
+            trap, arguments = is_trap(arguments)
             arguments = arguments[1:]
             (test.result, output) = run_codegen_test()
             output = '{} {}{}'.format('passed' if test.result == PASSED else 'FAILED', test_path, output)